@@ -0,0 +1,232 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+
+
+#include "ChildPoller.h"
+#include "Messages.h"
+
+#include <Autolock.h>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+// How often a child that closed all its pipes is checked for having exited
+static const bigtime_t kReapInterval = 10000;
+
+
+ChildPoller*
+ChildPoller::Default()
+{
+	// Lives as long as the app, like the children it watches
+	static ChildPoller* poller = new ChildPoller();
+	return poller;
+}
+
+
+ChildPoller::ChildPoller()
+	:
+	fLock("child poller")
+{
+	// The loop also waits on this pipe, to learn about new children
+	if (pipe(fWakeFDs) != 0)
+		fWakeFDs[0] = fWakeFDs[1] = -1;
+	for (int32 i = 0; i < 2; i++) {
+		if (fWakeFDs[i] >= 0) {
+			fcntl(fWakeFDs[i], F_SETFD, FD_CLOEXEC);
+			fcntl(fWakeFDs[i], F_SETFL, O_NONBLOCK);
+		}
+	}
+
+	fThread = spawn_thread(_Loop, "child poller", B_NORMAL_PRIORITY, this);
+	if (fThread >= B_OK)
+		resume_thread(fThread);
+}
+
+
+void
+ChildPoller::AddChild(pid_t pid, const int* fds, int32 count, BMessenger target)
+{
+	Child* child = new Child;
+	child->pid = pid;
+	child->target = target;
+	for (int32 i = 0; i < kMaxPipes; i++)
+		child->fds[i] = (i < count) ? fds[i] : -1;
+
+	BAutolock _(fLock);
+	fAdded.push_back(child);
+	_Wake();
+}
+
+
+status_t
+ChildPoller::Signal(pid_t pid, int signal)
+{
+	// The child is reaped with the lock held, it's either still known here
+	// or gone for good
+	BAutolock _(fLock);
+	bool found = false;
+	for (Child* child : fChildren)
+		found |= child->pid == pid;
+	for (Child* child : fAdded)
+		found |= child->pid == pid;
+	if (!found)
+		return B_BAD_VALUE;
+
+	return (kill(-pid, signal) == 0) ? B_OK : errno;
+}
+
+
+void
+ChildPoller::KillAll()
+{
+	BAutolock _(fLock);
+	for (Child* child : fChildren)
+		kill(-child->pid, SIGKILL);
+	for (Child* child : fAdded)
+		kill(-child->pid, SIGKILL);
+}
+
+
+void
+ChildPoller::_Wake()
+{
+	char wake = 0;
+	if (fWakeFDs[1] >= 0)
+		write(fWakeFDs[1], &wake, 1);
+}
+
+
+status_t
+ChildPoller::_Loop(void* self)
+{
+	((ChildPoller*)self)->_Run();
+	return B_OK;
+}
+
+
+void
+ChildPoller::_Run()
+{
+	std::vector<struct pollfd> fds;
+	std::vector<Child*> owners;
+	std::vector<int32> indices;
+
+	while (true) {
+		fLock.Lock();
+		fChildren.insert(fChildren.end(), fAdded.begin(), fAdded.end());
+		fAdded.clear();
+		fLock.Unlock();
+
+		fds.clear();
+		owners.clear();
+		indices.clear();
+
+		struct pollfd wake = { fWakeFDs[0], POLLIN, 0 };
+		fds.push_back(wake);
+		owners.push_back(NULL);
+		indices.push_back(-1);
+
+		// Wake up to check on a child that closed its pipes but didn't
+		// exit yet
+		bool waiting = false;
+		for (Child* child : fChildren) {
+			bool open = false;
+			for (int32 i = 0; i < kMaxPipes; i++) {
+				if (child->fds[i] < 0)
+					continue;
+
+				struct pollfd pipe = { child->fds[i], POLLIN, 0 };
+				fds.push_back(pipe);
+				owners.push_back(child);
+				indices.push_back(i);
+				open = true;
+			}
+			waiting |= !open;
+		}
+
+		int timeout = waiting ? kReapInterval / 1000 : -1;
+		int result = poll(fds.data(), fds.size(), timeout);
+		if (result < 0 && errno != EINTR) {
+			// not expected to happen, but shouldn't become a busy loop
+			snooze(kReapInterval);
+			continue;
+		}
+
+		if (result > 0) {
+			if (fds[0].revents != 0) {
+				char wake_data[64];
+				while (read(fWakeFDs[0], wake_data, sizeof(wake_data)) > 0)
+					;
+			}
+			_ReadPipes(fds, owners, indices);
+		}
+
+		_CheckChildren();
+	}
+}
+
+
+void
+ChildPoller::_ReadPipes(const std::vector<struct pollfd>& fds,
+	const std::vector<Child*>& owners, const std::vector<int32>& indices)
+{
+	for (size_t i = 1; i < fds.size(); i++) {
+		if (fds[i].revents == 0)
+			continue;
+
+		Child* child = owners[i];
+		int32 index = indices[i];
+		ssize_t amount_read = read(fds[i].fd, fBuffer, sizeof(fBuffer));
+		if (amount_read > 0) {
+			BMessage output(M_CHILD_OUTPUT);
+			output.AddInt32("pid", child->pid);
+			output.AddInt32("index", index);
+			output.AddData("data", B_RAW_TYPE, fBuffer, amount_read);
+			child->target.SendMessage(&output);
+		} else if (amount_read == 0 || (errno != EINTR && errno != EAGAIN)) {
+			close(child->fds[index]);
+			child->fds[index] = -1;
+		}
+	}
+}
+
+
+void
+ChildPoller::_CheckChildren()
+{
+	for (size_t i = 0; i < fChildren.size();) {
+		Child* child = fChildren[i];
+		bool open = false;
+		for (int32 j = 0; j < kMaxPipes; j++)
+			open |= child->fds[j] >= 0;
+
+		if (!open) {
+			fLock.Lock();
+			int status = 0;
+			pid_t waited = waitpid(child->pid, &status, WNOHANG);
+			if (waited == 0 || (waited < 0 && errno == EINTR)) {
+				// still running, try again later
+				fLock.Unlock();
+				i++;
+				continue;
+			}
+			fChildren.erase(fChildren.begin() + i);
+			fLock.Unlock();
+
+			// after all of its output, as the messages keep their order
+			BMessage exited(M_CHILD_EXITED);
+			exited.AddInt32("pid", child->pid);
+			exited.AddInt32("status", waited == child->pid ? status : -1);
+			child->target.SendMessage(&exited);
+			delete child;
+			continue;
+		}
+		i++;
+	}
+}
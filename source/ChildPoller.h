@@ -0,0 +1,72 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+#ifndef CHILDPOLLER_H
+#define CHILDPOLLER_H
+
+
+#include <Locker.h>
+#include <Messenger.h>
+#include <OS.h>
+
+#include <poll.h>
+#include <sys/types.h>
+#include <vector>
+
+
+// Reads the output of all running child processes in one thread. A child
+// is added with the read ends of its pipes, which then belong to the
+// poller. Every pipe is drained, also those nobody is interested in, so a
+// child never gets stuck writing to a full pipe. Once all pipes are closed
+// the child is reaped.
+// What was read is posted to the target as M_CHILD_OUTPUT, with the "pid",
+// the "index" of the pipe in the array given to AddChild() and the "data".
+// The end is posted as M_CHILD_EXITED, with the "pid" and the waitpid()
+// "status", or -1 if the child couldn't be waited for. So the target sees
+// its children only from its own thread.
+class ChildPoller {
+public:
+	static ChildPoller*	Default();
+
+	// fds may contain -1 for pipes the child doesn't have
+	void				AddChild(pid_t pid, const int* fds, int32 count,
+							BMessenger target);
+	// Sends the signal to the process group of a child, but only until it
+	// was reaped, so it can't hit another process that got the same ID
+	status_t			Signal(pid_t pid, int signal);
+	// Kills all children right away, e.g. when the app quits
+	void				KillAll();
+
+private:
+	static const int32	kMaxPipes = 3;
+
+	struct Child {
+		pid_t			pid;
+		int				fds[kMaxPipes];
+		BMessenger		target;
+	};
+
+						ChildPoller();
+
+	static status_t		_Loop(void* self);
+	void				_Run();
+	void				_Wake();
+	void				_ReadPipes(const std::vector<struct pollfd>& fds,
+							const std::vector<Child*>& owners,
+							const std::vector<int32>& indices);
+	void				_CheckChildren();
+
+	BLocker				fLock;
+	// children added since the loop last looked
+	std::vector<Child*>	fAdded;
+	// only changed by the poller thread, with the lock held
+	std::vector<Child*>	fChildren;
+
+	int					fWakeFDs[2];
+	thread_id			fThread;
+	char				fBuffer[65536];
+};
+
+
+#endif // CHILDPOLLER_H
@@ -8,14 +8,40 @@
 
 
 #include "CommandLauncher.h"
+#include "ChildPoller.h"
 #include "Messages.h"
+#include "ProgressParser.h"
 #include "Utilities.h"
 
+#include <Autolock.h>
+#include <Bitmap.h>
+#include <Locker.h>
+#include <MessageRunner.h>
+
 #include <algorithm>
-#include <array>
 #include <cstdio>
-#include <iostream>
+#include <cstring>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
 #include <unistd.h>
+#include <vector>
+
+
+// Until our pipe ends are marked close-on-exec, a child another launcher
+// starts at the same time would inherit them and keep them open
+static BLocker sSpawnLock("spawn lock");
+
+// ffmpeg is told to write its "-progress" output to this fd
+static const int kProgressFD = 3;
+
+// the order of our pipe ends handed to the ChildPoller
+enum {
+	kStdoutPipe = 0,
+	kStderrPipe,
+	kProgressPipe
+};
 
 
 CommandLauncher::CommandLauncher(BMessenger* target_messenger)
@@ -23,206 +49,687 @@ CommandLauncher::CommandLauncher(BMessenger* target_messenger)
 	BLooper("CommandLauncher"),
 	fTargetMessenger(target_messenger),
 	fOutputMessage(NULL),
-	fFinishMessage(NULL)
+	fFinishMessage(NULL),
+	fImage(NULL)
 {
 	fBusy = false;
 	fErrorCode = 0;
+	fUpdateRate = kDefaultUpdateRate;
+	fPriority = B_NORMAL_PRIORITY;
+	fChild = -1;
+	fShell = false;
+	fStartTime = 0;
+	fStopTime = 0;
+	fKillRunner = NULL;
+	fPauseStart = 0;
+	fPausedTime = 0;
+	fProgress.time_us = -1;
+	fPendingProgress = false;
+	fPendingUpdates = 0;
+	fLastUpdate = 0;
+	fFlushRunner = NULL;
+	fSpawnTime = 0;
+	fUpdateCount = 0;
+	fMessageCount = 0;
+	fCommandWhat = 0;
 	Run();
 }
 
 
+CommandLauncher::~CommandLauncher()
+{
+	// a command still running doesn't outlive its launcher
+	if (fChild >= 0)
+		ChildPoller::Default()->Signal(fChild, SIGKILL);
+
+	delete fKillRunner;
+	delete fFlushRunner;
+	for (BMessage* command : fQueue)
+		delete command;
+}
+
+
 void
 CommandLauncher::MessageReceived(BMessage* message)
 {
 	switch (message->what) {
 		case M_STOP_COMMAND:
 		{
-			if (fBusy) {
+			// the waiting commands go as well
+			while (!fQueue.empty()) {
+				_Drop(fQueue.front());
+				fQueue.pop_front();
+			}
+			if (!fBusy)
+				break;
+
+			// With "graceful", ffmpeg is interrupted like with Ctrl-C and
+			// finishes the output, so what's encoded so far is playable.
+			// If it takes too long, or on a second stop, it's killed.
+			if (fStopTime == 0)
+				fStopTime = system_time();
+			// a stopped process only reacts to SIGINT once it's continued
+			_Resume();
+			if (message->GetBool("graceful", false) && fCommandFlag == ENCODING
+				&& fErrorCode == SUCCESS && fChild >= 0) {
+				fErrorCode = STOPPED;
+				ChildPoller::Default()->Signal(fChild, SIGINT);
+				_SendTimer(fKillRunner, M_KILL_TIMEOUT, kStopTimeout);
+			} else {
 				fErrorCode = ABORTED;
-				kill_thread(fThread);
+				_Kill();
 			}
 			break;
 		}
+		case M_PAUSE_COMMAND:
+		{
+			// The whole process group is stopped until it's resumed. The
+			// time in between doesn't count as time spent on the command.
+			if (!fBusy || fChild < 0 || fPauseStart > 0 || fErrorCode != SUCCESS)
+				break;
+
+			ChildPoller::Default()->Signal(fChild, SIGSTOP);
+			fPauseStart = system_time();
+			break;
+		}
+		case M_RESUME_COMMAND:
+		{
+			_Resume();
+			break;
+		}
+		case M_CHILD_OUTPUT:
+		{
+			// output of a child that's gone has no command to go to
+			const void* data;
+			ssize_t length;
+			if (message->GetInt32("pid", -1) != fChild
+				|| message->FindData("data", B_RAW_TYPE, &data, &length) != B_OK)
+				break;
+
+			_ChildOutput(message->GetInt32("index", -1), (const char*)data, length);
+			break;
+		}
+		case M_CHILD_EXITED:
+		{
+			if (message->GetInt32("pid", -1) == fChild)
+				_ChildExited(message->GetInt32("status", -1));
+			break;
+		}
+		case M_FLUSH_OUTPUT:
+		{
+			if (message->GetInt32("pid", -1) != fChild)
+				break;
+
+			delete fFlushRunner;
+			fFlushRunner = NULL;
+			if (fPendingUpdates > 0)
+				_FlushOutput();
+			break;
+		}
+		case M_KILL_TIMEOUT:
+		{
+			// ffmpeg didn't finish the output in time
+			if (message->GetInt32("pid", -1) != fChild || fErrorCode != STOPPED)
+				break;
+
+			delete fKillRunner;
+			fKillRunner = NULL;
+			fErrorCode = ABORTED;
+			_Kill();
+			break;
+		}
 		case M_ENCODE_COMMAND:
+		case M_INFO_COMMAND:
+		case M_EXTRACTIMAGE_COMMAND:
 		{
-			if (!fBusy) {
-				fOutputMessage = new BMessage(M_ENCODE_PROGRESS);
-				fFinishMessage = new BMessage(M_ENCODE_FINISHED);
-				message->FindString("cmdline", &fCommandline);
-				fBusy = true;
-				fErrorCode = 0;
-				fCommandFlag = ENCODING;
-
-				thread_id thread
-					= spawn_thread(_Command, "ffmpeg command", B_LOW_PRIORITY, this);
-				if (thread >= B_OK)
-					resume_thread(thread);
+			// Commands that arrive while another one runs wait for their
+			// turn. One marked "latest" replaces those of its kind that
+			// still wait or run, e.g. the probe of a file no longer looked at.
+			if (message->GetBool("latest", false)) {
+				for (std::deque<BMessage*>::iterator it = fQueue.begin();
+						it != fQueue.end();) {
+					if ((*it)->what == message->what) {
+						_Drop(*it);
+						it = fQueue.erase(it);
+					} else
+						it++;
+				}
+				if (fBusy && fCommandWhat == message->what) {
+					fErrorCode = ABORTED;
+					_Kill();
+				}
 			}
+
+			fQueue.push_back(new BMessage(*message));
+			_StartNext();
+			break;
+		}
+		case M_NEXT_COMMAND:
+		{
+			_StartNext();
+			break;
+		}
+		default:
+			BLooper::MessageReceived(message);
+	}
+}
+
+
+void
+CommandLauncher::_StartNext()
+{
+	if (fBusy || fQueue.empty())
+		return;
+
+	BMessage* message = fQueue.front();
+	fQueue.pop_front();
+	fCommandWhat = message->what;
+
+	switch (message->what) {
+		case M_ENCODE_COMMAND:
+		{
+			fOutputMessage = new BMessage(M_ENCODE_PROGRESS);
+			fFinishMessage = new BMessage(M_ENCODE_FINISHED);
+			fCommandFlag = ENCODING;
 			break;
 		}
 		case M_INFO_COMMAND:
 		{
-			if (!fBusy) {
-				fOutputMessage = new BMessage(M_INFO_OUTPUT);
-				fFinishMessage = new BMessage(M_INFO_FINISHED);
-				message->FindString("cmdline", &fCommandline);
-				fBusy = true;
-				fErrorCode = 0;
-				fCommandFlag = INFO;
-
-				thread_id thread
-					= spawn_thread(_Command, "ffprobe command", B_LOW_PRIORITY, this);
-				if (thread >= B_OK)
-					resume_thread(thread);
-			}
+			fOutputMessage = new BMessage(M_INFO_OUTPUT);
+			fFinishMessage = new BMessage(M_INFO_FINISHED);
+			fCommandFlag = INFO;
 			break;
 		}
 		case M_EXTRACTIMAGE_COMMAND:
 		{
-			if (!fBusy) {
-				fOutputMessage = new BMessage();
-				fFinishMessage = new BMessage(M_EXTRACTIMAGE_FINISHED);
-				message->FindString("cmdline", &fCommandline);
-				fBusy = true;
-				fErrorCode = 0;
-				fCommandFlag = EXTRACTIMAGE;
-
-				thread_id thread
-					= spawn_thread(_Command, "ffmpeg command", B_LOW_PRIORITY, this);
-				if (thread >= B_OK)
-					resume_thread(thread);
+			fOutputMessage = new BMessage();
+			fFinishMessage = new BMessage(M_EXTRACTIMAGE_FINISHED);
+			fCommandFlag = EXTRACTIMAGE;
+
+			// The frame is written as raw pixels to stdout and goes
+			// straight into a bitmap of the size the sender asked for
+			int32 width = message->GetInt32("width", 0);
+			int32 height = message->GetInt32("height", 0);
+			if (width > 0 && height > 0) {
+				fImage = new BBitmap(BRect(0, 0, width - 1, height - 1), B_RGB32);
+				if (!fImage->IsValid()) {
+					delete fImage;
+					fImage = NULL;
+				}
 			}
+			fImageOffset = 0;
+			fImageLength = (int64)width * height * 4;
 			break;
 		}
-		default:
-			BLooper::MessageReceived(message);
 	}
+
+	_SetCommand(message);
+	_SetCommandID(message);
+	_SetUpdateRate(message);
+	fPriority = message->GetInt32("priority", B_NORMAL_PRIORITY);
+	fBusy = true;
+	fErrorCode = 0;
+	fStopTime = 0;
+	fPauseStart = 0;
+	fPausedTime = 0;
+	fErrorMatcher.Reset();
+	delete message;
+
+	_StartCommand();
 }
 
 
-status_t
-CommandLauncher::_Command(void* _self)
+void
+CommandLauncher::_Drop(BMessage* command)
 {
-	CommandLauncher* self = (CommandLauncher*) _self;
-	self->_RunCommand();
-	return B_OK;
+	// A command that never ran is reported as aborted, so the sender gets
+	// a finish message for every command
+	uint32 what = M_ENCODE_FINISHED;
+	if (command->what == M_INFO_COMMAND)
+		what = M_INFO_FINISHED;
+	else if (command->what == M_EXTRACTIMAGE_COMMAND)
+		what = M_EXTRACTIMAGE_FINISHED;
+
+	BMessage finish_message(what);
+	int32 id;
+	if (command->FindInt32("id", &id) == B_OK)
+		finish_message.AddInt32("id", id);
+	finish_message.AddInt32("exitcode", ABORTED);
+	finish_message.AddInt64("elapsed", 0);
+	finish_message.AddInt32("updates", 0);
+	finish_message.AddInt32("messages", 0);
+	fTargetMessenger->SendMessage(&finish_message);
+	delete command;
 }
 
 
 void
-CommandLauncher::_RunCommand()
+CommandLauncher::_StartCommand()
 {
-	// redirect stderr + stout
-	int stderr_pipe[2];
-	int stdout_pipe[2];
-	int original_stderr = dup(STDERR_FILENO);
-	int original_stdout = dup(STDOUT_FILENO);
+	fStartTime = system_time();
+
+	// Let ffmpeg write its machine-readable progress to a pipe on fd 3
+	BStringList arguments(fArguments);
+	bool with_progress = (fCommandFlag == ENCODING) && !arguments.IsEmpty();
+	if (with_progress && fShell) {
+		// it goes into the commandline the shell is given
+		BString commandline(arguments.StringAt(2));
+		int32 position = commandline.FindFirst(" ");
+		with_progress = (position != B_ERROR)
+			&& (commandline.FindFirst(" -progress ") == B_ERROR);
+		if (with_progress) {
+			commandline.Insert(" -progress pipe:3", position);
+			arguments.Replace(2, commandline);
+		}
+	} else if (with_progress) {
+		with_progress = !arguments.HasString("-progress");
+		if (with_progress) {
+			arguments.Add("pipe:3", 1);
+			arguments.Add("-progress", 1);
+		}
+	}
 
-	if (pipe(stderr_pipe) == 0) {
-		dup2(stderr_pipe[1], STDERR_FILENO);
-		close(stderr_pipe[1]);
+	// The child gets our pipes as stdout, stderr (and progress). All our
+	// ends are above fd 3 and closed on exec, so they don't end up in
+	// processes other launchers start at the same time.
+	int stderr_pipe[2] = { -1, -1 };
+	int stdout_pipe[2] = { -1, -1 };
+	int progress_pipe[2] = { -1, -1 };
+
+	sSpawnLock.Lock();
+	_OpenPipe(stderr_pipe);
+	_OpenPipe(stdout_pipe);
+	if (with_progress)
+		_OpenPipe(progress_pipe);
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	if (stdout_pipe[1] >= 0)
+		posix_spawn_file_actions_adddup2(&actions, stdout_pipe[1], STDOUT_FILENO);
+	if (stderr_pipe[1] >= 0)
+		posix_spawn_file_actions_adddup2(&actions, stderr_pipe[1], STDERR_FILENO);
+	if (progress_pipe[1] >= 0)
+		posix_spawn_file_actions_adddup2(&actions, progress_pipe[1], kProgressFD);
+
+	// in its own process group, so it can be stopped with all its children
+	posix_spawnattr_t attributes;
+	posix_spawnattr_init(&attributes);
+	posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+	posix_spawnattr_setpgroup(&attributes, 0);
+
+	std::vector<BString> strings;
+	for (int32 i = 0; i < arguments.CountStrings(); i++)
+		strings.push_back(arguments.StringAt(i));
+	std::vector<char*> argv;
+	for (size_t i = 0; i < strings.size(); i++)
+		argv.push_back(const_cast<char*>(strings[i].String()));
+	argv.push_back(NULL);
+
+	bigtime_t spawn_start = system_time();
+	pid_t pid = -1;
+	status_t error_code = B_BAD_VALUE;
+	if (!arguments.IsEmpty())
+		error_code = posix_spawnp(&pid, argv[0], &actions, &attributes, argv.data(), environ);
+	fSpawnTime = system_time() - spawn_start;
+
+	posix_spawnattr_destroy(&attributes);
+	posix_spawn_file_actions_destroy(&actions);
+	_ClosePipeEnd(stderr_pipe[1]);
+	_ClosePipeEnd(stdout_pipe[1]);
+	_ClosePipeEnd(progress_pipe[1]);
+	sSpawnLock.Unlock();
+
+	if (error_code != 0) {
+		_ClosePipeEnd(stderr_pipe[0]);
+		_ClosePipeEnd(stdout_pipe[0]);
+		_ClosePipeEnd(progress_pipe[0]);
+		_Finish(FAILED);
+		return;
 	}
-	if (pipe(stdout_pipe) == 0) {
-		dup2(stdout_pipe[1], STDOUT_FILENO);
-		close(stdout_pipe[1]);
+
+	fChild = pid;
+	if (fPriority != B_NORMAL_PRIORITY)
+		set_thread_priority(fChild, fPriority);
+
+	fParser.Reset();
+	fProgress.time_us = -1;
+	fPendingData = "";
+	fPendingProgress = false;
+	fPendingUpdates = 0;
+	fLastUpdate = 0;
+	fUpdateCount = 0;
+	fMessageCount = 0;
+
+	// From here on the poller owns our ends of the pipes
+	int fds[] = { stdout_pipe[0], stderr_pipe[0], progress_pipe[0] };
+	ChildPoller::Default()->AddChild(pid, fds, 3, BMessenger(this));
+}
+
+
+void
+CommandLauncher::_ChildOutput(int32 index, const char* data, ssize_t length)
+{
+	if (index == kProgressPipe) {
+		int32 blocks = fParser.Feed(data, length);
+		if (blocks > 0) {
+			fProgress = fParser.Info();
+			fPendingProgress = true;
+			fPendingUpdates += blocks;
+		}
+	} else if (index == kStdoutPipe && fCommandFlag == EXTRACTIMAGE)
+		_ReadImageData(data, length);
+	else if (index == ((fCommandFlag == ENCODING) ? kStderrPipe : kStdoutPipe)) {
+		fPendingData.Append(data, length);
+		fPendingUpdates++;
+
+		// check if ffmpeg's log contains error messages
+		if (fCommandFlag == ENCODING
+			&& fErrorMatcher.Feed(data, length) == PATTERN_ABORT
+			&& fErrorCode == SUCCESS) {
+			fErrorCode = FAILED;
+			_Kill();
+		}
 	}
+	// Output of the other pipe is dropped. It's read all the same, so
+	// the child doesn't get stuck once that pipe is full.
+
+	if (fPendingUpdates == 0)
+		return;
+	if (system_time() - fLastUpdate >= 1000000 / fUpdateRate)
+		_FlushOutput();
+	else
+		_ScheduleFlush();
+}
 
-	int pipe_flags = fcntl(stderr_pipe[0], F_GETFD);
-	pipe_flags |= FD_CLOEXEC;
-	fcntl(stderr_pipe[0], F_SETFD, pipe_flags);
 
-	pipe_flags = fcntl(stdout_pipe[0], F_GETFD);
-	pipe_flags |= FD_CLOEXEC;
-	fcntl(stdout_pipe[0], F_SETFD, pipe_flags);
+void
+CommandLauncher::_ChildExited(int status)
+{
+	// whatever is left goes out before the finish message
+	if (fPendingUpdates > 0)
+		_FlushOutput();
+
+	status_t exit_code = FAILED;
+	// ffmpeg's own exit codes could be mistaken for ABORTED or STOPPED
+	if (status >= 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0)
+		exit_code = SUCCESS;
+	fChild = -1;
 
-	// create thread for ffmpeg
-	const char* arguments[4];
-	arguments[0] = "/bin/sh";
-	arguments[1] = "-c";
-	arguments[2] = fCommandline.String();
-	arguments[3] = nullptr;
+	_Finish(exit_code);
+}
 
-	fThread = load_image(3, arguments, const_cast<const char**>(environ));
-	status_t error_code = fThread;
 
-	if (error_code >= 0) {
-		setpgid(fThread, fThread);
-		error_code = resume_thread(fThread);
+void
+CommandLauncher::_Finish(status_t exit_code)
+{
+	// inform target that the command has finished
+	if (fErrorCode != SUCCESS)
+		exit_code = fErrorCode;
+
+	// without any progress, there's nothing of the output to keep
+	if (exit_code == STOPPED && fProgress.time_us <= 0)
+		exit_code = ABORTED;
+
+	// only a complete frame is handed over, the target takes ownership
+	if (fImage != NULL) {
+		if (exit_code == SUCCESS && fImageOffset == fImageLength)
+			fFinishMessage->AddPointer("bitmap", fImage);
+		else
+			delete fImage;
+		fImage = NULL;
 	}
 
-	dup2(original_stderr, STDERR_FILENO);
-	dup2(original_stdout, STDOUT_FILENO);
+	delete fKillRunner;
+	fKillRunner = NULL;
+	delete fFlushRunner;
+	fFlushRunner = NULL;
 
-	// read stderr output and send to target
-	if (error_code >= 0) {
-		char buffer[4096];
-		while (true) {
-			ssize_t amount_read;
-			if ((fCommandFlag == ENCODING) or (fCommandFlag == EXTRACTIMAGE))
-				amount_read = read(stderr_pipe[0], buffer, sizeof(buffer));
-			else
-				amount_read = read(stdout_pipe[0], buffer, sizeof(buffer));
+	// We're ready for the next command before the target learns about this
+	// one finishing, so it can immediately reuse this launcher
+	BMessage* finish_message = fFinishMessage;
+	delete fOutputMessage;
+	fOutputMessage = NULL;
+	fFinishMessage = NULL;
+	fBusy = false;
 
-			if (amount_read <= 0)
-				break;
+	// the next waiting command is started by the looper
+	PostMessage(M_NEXT_COMMAND);
+
+	finish_message->AddInt32("exitcode", exit_code);
+	finish_message->AddInt64("elapsed", _ActiveTime());
+	finish_message->AddInt64("paused", fPausedTime);
+	finish_message->AddInt32("updates", fUpdateCount);
+	finish_message->AddInt32("messages", fMessageCount);
+	finish_message->AddInt64("spawn_time", fSpawnTime);
+	if (fStopTime > 0)
+		finish_message->AddInt64("stop_latency", system_time() - fStopTime);
+	// how much of the source the stopped output covers
+	if (exit_code == STOPPED)
+		finish_message->AddInt64("time_us", fProgress.time_us);
+	// what kind of failure, as far as it could be told from the log
+	if (exit_code == FAILED)
+		finish_message->AddInt32("error", fErrorMatcher.Error());
+	finish_message->AddInt32("flagged", fErrorMatcher.Flagged());
+	fTargetMessenger->SendMessage(finish_message);
+	delete finish_message;
+}
 
-			// Make sure the buffer is null terminated
-			buffer[amount_read] = 0;
-
-			if (fCommandFlag != EXTRACTIMAGE)
-			{
-				int32 seconds = _GetCurrentTime(buffer);
-				fOutputMessage->AddInt32("time", seconds);
-				fOutputMessage->AddString("data", buffer);
-				fTargetMessenger->SendMessage(fOutputMessage);
-				fOutputMessage->RemoveName("time");
-				fOutputMessage->RemoveName("data");
-			}
 
-			// check if output contains error messages
-			BString output_string(buffer);
-			if (output_string.FindFirst("Error while decoding stream") != B_ERROR) {
-				fErrorCode = FAILED;
-				kill_thread(fThread);
-				break;
-			}
+void
+CommandLauncher::_FlushOutput()
+{
+	_SendOutput(fPendingData, fPendingProgress ? &fProgress : NULL, fPendingUpdates);
+	fPendingProgress = false;
+	fPendingUpdates = 0;
+	fLastUpdate = system_time();
+}
+
+
+void
+CommandLauncher::_ScheduleFlush()
+{
+	// what's pending goes out once the update interval is over, even if
+	// the child stays quiet until then
+	if (fFlushRunner != NULL)
+		return;
+
+	bigtime_t delay = fLastUpdate + 1000000 / fUpdateRate - system_time();
+	_SendTimer(fFlushRunner, M_FLUSH_OUTPUT, std::max(delay, (bigtime_t)1));
+}
+
+
+void
+CommandLauncher::_SendTimer(BMessageRunner*& runner, uint32 what, bigtime_t delay)
+{
+	// Tagged with the child, a timer of a command that's over is ignored
+	delete runner;
+	BMessage timer(what);
+	timer.AddInt32("pid", fChild);
+	runner = new BMessageRunner(BMessenger(this), &timer, delay, 1);
+}
+
+
+void
+CommandLauncher::_SetCommand(BMessage* message)
+{
+	// An "argv" is run as it is. A "cmdline" is split into arguments like
+	// the shell would, or, if asked for, really run by the shell.
+	fArguments.MakeEmpty();
+	fShell = false;
+	if (message->FindStrings("argv", &fArguments) == B_OK)
+		return;
+
+	BString commandline;
+	message->FindString("cmdline", &commandline);
+	fShell = message->GetBool("shell", false);
+	if (fShell) {
+		fArguments.Add("/bin/sh");
+		fArguments.Add("-c");
+		fArguments.Add(commandline);
+	} else
+		tokenize_commandline(commandline, fArguments);
+}
+
+
+void
+CommandLauncher::_SetCommandID(BMessage* message)
+{
+	// The sender can tag a command with an ID that gets passed back with
+	// every output and finish message, e.g. to tell apart parallel jobs
+	int32 id;
+	if (message->FindInt32("id", &id) != B_OK)
+		return;
+
+	fOutputMessage->AddInt32("id", id);
+	fFinishMessage->AddInt32("id", id);
+}
+
+
+void
+CommandLauncher::_SetUpdateRate(BMessage* message)
+{
+	fUpdateRate = message->GetInt32("update_rate", kDefaultUpdateRate);
+	fUpdateRate = std::max((int32)1, std::min(fUpdateRate, (int32)1000));
+}
+
+
+void
+CommandLauncher::_SendOutput(BString& data, const ProgressInfo* progress, int32 updates)
+{
+	if (!data.IsEmpty())
+		fOutputMessage->AddString("data", data);
+
+	if (progress != NULL) {
+		// ffmpeg's rates count the time it was paused, those are left out
+		bigtime_t active_time = _ActiveTime();
+		float fps = progress->fps;
+		float speed = progress->speed;
+		if (fPausedTime > 0 && active_time > 0) {
+			if (progress->frame >= 0)
+				fps = progress->frame * 1000000.0f / active_time;
+			if (progress->time_us >= 0)
+				speed = (float)progress->time_us / active_time;
 		}
+
+		fOutputMessage->AddInt64("time_us", progress->time_us);
+		fOutputMessage->AddInt64("frame", progress->frame);
+		fOutputMessage->AddFloat("fps", fps);
+		fOutputMessage->AddFloat("bitrate", progress->bitrate);
+		fOutputMessage->AddInt64("total_size", progress->total_size);
+		fOutputMessage->AddFloat("speed", speed);
+		fOutputMessage->AddInt64("active_us", active_time);
 	}
 
-	// clean up
-	dup2(original_stderr, STDERR_FILENO);
-	close(stderr_pipe[0]);
-	dup2(original_stdout, STDOUT_FILENO);
-	close(stdout_pipe[0]);
+	// how many pieces of output were merged into this message
+	fOutputMessage->AddInt32("merged", updates);
+	fTargetMessenger->SendMessage(fOutputMessage);
+	fUpdateCount += updates;
+	fMessageCount++;
+
+	fOutputMessage->RemoveName("data");
+	fOutputMessage->RemoveName("time_us");
+	fOutputMessage->RemoveName("frame");
+	fOutputMessage->RemoveName("fps");
+	fOutputMessage->RemoveName("bitrate");
+	fOutputMessage->RemoveName("total_size");
+	fOutputMessage->RemoveName("speed");
+	fOutputMessage->RemoveName("active_us");
+	fOutputMessage->RemoveName("merged");
+	data = "";
+}
 
-	status_t proc_exit_code = 0;
-	wait_for_thread(fThread, &proc_exit_code);
 
-	// inform target that the command has finished
-	if (fErrorCode != SUCCESS)
-		proc_exit_code = fErrorCode;
+void
+CommandLauncher::_ReadImageData(const char* data, ssize_t length)
+{
+	if (fImage == NULL)
+		return;
+
+	// ffmpeg writes the rows without padding, the bitmap may have some
+	int32 row_length = fImage->Bounds().IntegerWidth() * 4 + 4;
+	int32 bytes_per_row = fImage->BytesPerRow();
+	uint8* bits = (uint8*)fImage->Bits();
+
+	while (length > 0 && fImageOffset < fImageLength) {
+		int64 row = fImageOffset / row_length;
+		int32 column = fImageOffset % row_length;
+		int32 amount = std::min((int32)length, row_length - column);
+		memcpy(bits + row * bytes_per_row + column, data, amount);
+		fImageOffset += amount;
+		data += amount;
+		length -= amount;
+	}
+}
 
-	fFinishMessage->AddInt32("exitcode", proc_exit_code);
-	fTargetMessenger->SendMessage(fFinishMessage);
-	fBusy = false;
 
-	delete fOutputMessage;
-	delete fFinishMessage;
+void
+CommandLauncher::_Kill()
+{
+	// the whole process group, so nothing the command started lives on
+	if (fChild >= 0)
+		ChildPoller::Default()->Signal(fChild, SIGKILL);
 }
 
 
-int32
-CommandLauncher::_GetCurrentTime(const char* buffer)
+void
+CommandLauncher::_Resume()
+{
+	if (fPauseStart == 0)
+		return;
+
+	if (fChild >= 0)
+		ChildPoller::Default()->Signal(fChild, SIGCONT);
+	fPausedTime += system_time() - fPauseStart;
+	fPauseStart = 0;
+}
+
+
+bigtime_t
+CommandLauncher::_ActiveTime()
 {
-	BString output(buffer);
-	int32 time_startpos = output.FindFirst("time=");
-	if (time_startpos == -1)
-		return -1;
+	// the time since the start, without the time it was paused
+	bigtime_t now = system_time();
+	bigtime_t paused = fPausedTime;
+	if (fPauseStart > 0)
+		paused += now - fPauseStart;
+	return now - fStartTime - paused;
+}
 
-	time_startpos += 5;
-	int32 time_endpos = output.FindFirst(".", time_startpos);
-	BString time_string;
-	output.CopyInto(time_string, time_startpos, time_endpos - time_startpos);
 
-	return (string_to_seconds(time_string));
+void
+CommandLauncher::_OpenPipe(int fds[2])
+{
+	if (pipe(fds) != 0) {
+		fds[0] = fds[1] = -1;
+		return;
+	}
+	fds[0] = _MoveFD(fds[0]);
+	fds[1] = _MoveFD(fds[1]);
+}
+
+
+void
+CommandLauncher::_ClosePipeEnd(int& fd)
+{
+	if (fd >= 0)
+		close(fd);
+	fd = -1;
+}
+
+
+int
+CommandLauncher::_MoveFD(int fd)
+{
+	// Moves a file descriptor of ours out of the range the child inherits
+	// and closes it on exec
+	if (fd < 0)
+		return fd;
+
+	int moved = fcntl(fd, F_DUPFD, kProgressFD + 1);
+	if (moved < 0)
+		return fd;
+
+	close(fd);
+	fcntl(moved, F_SETFD, fcntl(moved, F_GETFD) | FD_CLOEXEC);
+	return moved;
 }
@@ -11,10 +11,19 @@
 #define COMMANDLAUNCHER_H
 
 
+#include "ErrorMatcher.h"
+#include "ProgressParser.h"
+
 #include <Looper.h>
 #include <Messenger.h>
 #include <String.h>
+#include <StringList.h>
+
+#include <deque>
+
 
+class BBitmap;
+class BMessageRunner;
 
 enum {
 	ENCODING = 0,
@@ -25,28 +34,95 @@ enum {
 enum {
 	SUCCESS = 0,
 	FAILED,
-	ABORTED
+	ABORTED,
+	STOPPED		// stopped early, ffmpeg finished the output up to there
 };
 
+// How long ffmpeg gets to finish the output after a graceful stop, before
+// it's killed
+const bigtime_t kStopTimeout = 5000000;
+
+// Output messages per second, if a command doesn't ask for another
+// rate with an "update_rate" field
+const int32 kDefaultUpdateRate = 10;
+
+// Runs one command at a time, the others wait in order. The output is read
+// by the ChildPoller, which posts it to the launcher, so all of its state
+// is only touched by its own thread.
 class CommandLauncher : public BLooper {
 public:
 					CommandLauncher(BMessenger* target_messenger);
+					~CommandLauncher();
 
 	void 			MessageReceived(BMessage* message);
 
 private:
-	static status_t	_Command(void* self);
-	void 			_RunCommand();
-	int32			_GetCurrentTime(const char* buffer);
+	void			_ChildOutput(int32 index, const char* data, ssize_t length);
+	void			_ChildExited(int status);
+	void			_StartNext();
+	void			_Drop(BMessage* command);
+	void 			_StartCommand();
+	void			_Finish(status_t exit_code);
+	void			_FlushOutput();
+	void			_ScheduleFlush();
+	void			_SendTimer(BMessageRunner*& runner, uint32 what,
+						bigtime_t delay);
+	void			_SetCommand(BMessage* message);
+	void			_SetCommandID(BMessage* message);
+	void			_SetUpdateRate(BMessage* message);
+	void			_SendOutput(BString& data, const ProgressInfo* progress,
+						int32 updates);
+	void			_ReadImageData(const char* data, ssize_t length);
+	void			_Kill();
+	void			_Resume();
+	bigtime_t		_ActiveTime();
+	void			_OpenPipe(int fds[2]);
+	void			_ClosePipeEnd(int& fd);
+	int				_MoveFD(int fd);
 
-	BString 		fCommandline;
+	std::deque<BMessage*> fQueue;
+	uint32			fCommandWhat;
+
+	BStringList		fArguments;
+	bool			fShell;
 	BMessage* 		fOutputMessage;
 	BMessage* 		fFinishMessage;
 	BMessenger* 	fTargetMessenger;
 	bool			fBusy;
 	int32			fCommandFlag;
-	thread_id 		fThread;
+	pid_t			fChild;
+	bigtime_t		fStartTime;
+	bigtime_t		fSpawnTime;
+	bigtime_t		fStopTime;
+	// kills a gracefully stopped command that takes too long to finish
+	BMessageRunner*	fKillRunner;
+	// when the running command was paused, and for how long before
+	bigtime_t		fPauseStart;
+	bigtime_t		fPausedTime;
+	int32			fPriority;
 	status_t 		fErrorCode;
+
+	// the extracted frame, and how much of it was read so far
+	BBitmap*		fImage;
+	int64			fImageOffset;
+	int64			fImageLength;
+
+	// output messages per second, and how many pieces of output were
+	// merged into how many messages
+	int32			fUpdateRate;
+	int32			fUpdateCount;
+	int32			fMessageCount;
+
+	// output collected since the last message: log text is appended, of
+	// the progress only the latest state is kept
+	ProgressParser	fParser;
+	ErrorMatcher	fErrorMatcher;
+	BString			fPendingData;
+	ProgressInfo	fProgress;
+	bool			fPendingProgress;
+	int32			fPendingUpdates;
+	bigtime_t		fLastUpdate;
+	BMessageRunner*	fFlushRunner;
 };
 
 #endif // COMMANDLAUNCHER_H
@@ -0,0 +1,271 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+
+
+#include "CropDetector.h"
+#include "CommandLauncher.h"
+#include "Messages.h"
+#include "Utilities.h"
+
+#include <MessageRunner.h>
+#include <OS.h>
+
+#include <algorithm>
+#include <cstdio>
+
+
+// pieces of the source looked at, and frames per piece
+static const int32 kSamples = 8;
+static const int32 kFramesPerSample = 15;
+
+// whatever was found until then is used
+static const bigtime_t kTimeBudget = 800000;
+
+
+CropDetector::CropDetector(BMessenger* target_messenger)
+	:
+	BLooper("CropDetector"),
+	fTargetMessenger(target_messenger),
+	fTimeoutRunner(NULL),
+	fWidth(0),
+	fHeight(0),
+	fStartTime(0),
+	fTimedOut(false),
+	fRunning(0)
+{
+	system_info info;
+	get_system_info(&info);
+	int32 workers = std::max((int32)1, std::min((int32)info.cpu_count, kSamples));
+
+	fBusy.resize(workers, false);
+	fRest.resize(workers);
+	fLastCrop.resize(workers);
+	fHasCrop.resize(workers, false);
+	for (int32 i = 0; i < workers; i++)
+		fWorkers.push_back(new CommandLauncher(new BMessenger(this)));
+
+	Run();
+}
+
+
+CropDetector::~CropDetector()
+{
+	delete fTimeoutRunner;
+}
+
+
+void
+CropDetector::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case M_CROP_DETECT:
+		{
+			// one detection at a time
+			if (fRunning > 0 || !fQueue.empty())
+				break;
+
+			fSource = message->GetString("path", "");
+			int32 duration = message->GetInt32("duration", 0);
+			fWidth = message->GetInt32("width", 0);
+			fHeight = message->GetInt32("height", 0);
+			fStartTime = system_time();
+			fTimedOut = false;
+			fResults.clear();
+
+			if (fSource.IsEmpty() || fWidth <= 0 || fHeight <= 0) {
+				_Finish();
+				break;
+			}
+
+			// the pieces are spread evenly, none at the very start or end
+			int32 samples = std::max((int32)1, std::min(kSamples, duration));
+			for (int32 i = 0; i < samples; i++)
+				fQueue.push_back(duration * (2 * i + 1) / (2 * samples));
+
+			delete fTimeoutRunner;
+			BMessage timeout(M_CROP_TIMEOUT);
+			fTimeoutRunner = new BMessageRunner(BMessenger(this), &timeout,
+				kTimeBudget, 1);
+
+			_Dispatch();
+			break;
+		}
+		case M_CROP_TIMEOUT:
+		{
+			if (fRunning == 0)
+				break;
+
+			fTimedOut = true;
+			fQueue.clear();
+			for (size_t i = 0; i < fWorkers.size(); i++) {
+				if (fBusy[i])
+					fWorkers[i]->PostMessage(M_STOP_COMMAND);
+			}
+			break;
+		}
+		case M_ENCODE_PROGRESS:
+		{
+			int32 worker = message->GetInt32("id", -1);
+			BString data;
+			if (worker < 0 || worker >= (int32)fWorkers.size()
+				|| message->FindString("data", &data) != B_OK)
+				break;
+
+			_ParseOutput(worker, data);
+			break;
+		}
+		case M_ENCODE_FINISHED:
+		{
+			int32 worker = message->GetInt32("id", -1);
+			if (worker < 0 || worker >= (int32)fWorkers.size())
+				break;
+
+			// a last line without newline
+			_ParseOutput(worker, "\n");
+
+			// Even a piece that was cut short by the timeout has its
+			// frames looked at so far
+			if (fHasCrop[worker])
+				fResults.push_back(fLastCrop[worker]);
+
+			fBusy[worker] = false;
+			fRunning--;
+
+			_Dispatch();
+			if (fRunning == 0)
+				_Finish();
+			break;
+		}
+		default:
+			BLooper::MessageReceived(message);
+	}
+}
+
+
+void
+CropDetector::_Dispatch()
+{
+	while (!fQueue.empty()) {
+		int32 worker = -1;
+		for (size_t i = 0; i < fBusy.size(); i++) {
+			if (!fBusy[i]) {
+				worker = i;
+				break;
+			}
+		}
+		if (worker < 0)
+			return;
+
+		int32 second = fQueue.front();
+		fQueue.pop_front();
+		fBusy[worker] = true;
+		fRest[worker] = "";
+		fHasCrop[worker] = false;
+		fRunning++;
+
+		// reset=0 makes cropdetect report the area covering all frames
+		// looked at so far, so only its last report counts
+		BString input_options, output_options;
+		input_options << kFFMpeg << " -nostats -ss " << second << " -i";
+		output_options << "-frames:v " << kFramesPerSample
+			<< " -vf cropdetect=limit=24:round=2:reset=0 -an -sn -dn -f null -";
+
+		BStringList arguments, output_arguments;
+		tokenize_commandline(input_options, arguments);
+		arguments.Add(fSource);
+		tokenize_commandline(output_options, output_arguments);
+		arguments.Add(output_arguments);
+
+		BMessage detect(M_ENCODE_COMMAND);
+		detect.AddStrings("argv", arguments);
+		detect.AddInt32("id", worker);
+		fWorkers[worker]->PostMessage(&detect);
+	}
+}
+
+
+void
+CropDetector::_ParseOutput(int32 worker, const BString& data)
+{
+	BString& rest = fRest[worker];
+	rest << data;
+
+	int32 start = 0;
+	int32 end;
+	while ((end = rest.FindFirst('\n', start)) != B_ERROR) {
+		BString line;
+		rest.CopyInto(line, start, end - start);
+		start = end + 1;
+
+		Crop crop;
+		if (_ParseCrop(line, crop)) {
+			fLastCrop[worker] = crop;
+			fHasCrop[worker] = true;
+		}
+	}
+	rest.Remove(0, start);
+}
+
+
+bool
+CropDetector::_ParseCrop(const BString& line, Crop& crop)
+{
+	// [Parsed_cropdetect_0 @ 0x...] x1:0 x2:1919 ... crop=1920:800:0:140
+	int32 position = line.FindFirst("crop=");
+	if (position == B_ERROR)
+		return false;
+
+	int32 width, height, x, y;
+	if (sscanf(line.String() + position, "crop=%" B_SCNd32 ":%" B_SCNd32 ":%"
+			B_SCNd32 ":%" B_SCNd32, &width, &height, &x, &y) != 4)
+		return false;
+
+	// Black frames, e.g. of a fade, give an empty or nonsensical area
+	if (width < fWidth / 4 || height < fHeight / 4 || x < 0 || y < 0
+		|| x + width > fWidth || y + height > fHeight)
+		return false;
+
+	crop.top = y;
+	crop.bottom = fHeight - (y + height);
+	crop.left = x;
+	crop.right = fWidth - (x + width);
+	return true;
+}
+
+
+void
+CropDetector::_Finish()
+{
+	delete fTimeoutRunner;
+	fTimeoutRunner = NULL;
+
+	BMessage result(M_CROP_DETECTED);
+	int32 samples = fResults.size();
+	if (samples > 0) {
+		// The median of every edge keeps single odd pieces, like a dark
+		// scene, from changing the result. Of the two middle values of an
+		// even count the smaller one is taken, to rather crop too little.
+		std::vector<int32> top, bottom, left, right;
+		for (const Crop& crop : fResults) {
+			top.push_back(crop.top);
+			bottom.push_back(crop.bottom);
+			left.push_back(crop.left);
+			right.push_back(crop.right);
+		}
+		std::vector<int32>* edges[] = { &top, &bottom, &left, &right };
+		for (std::vector<int32>* edge : edges)
+			std::sort(edge->begin(), edge->end());
+
+		int32 middle = (samples - 1) / 2;
+		result.AddInt32("top", top[middle]);
+		result.AddInt32("bottom", bottom[middle]);
+		result.AddInt32("left", left[middle]);
+		result.AddInt32("right", right[middle]);
+	}
+	result.AddInt32("samples", samples);
+	result.AddBool("timeout", fTimedOut);
+	result.AddInt64("elapsed", system_time() - fStartTime);
+	fTargetMessenger->SendMessage(&result);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+#ifndef CROPDETECTOR_H
+#define CROPDETECTOR_H
+
+
+#include <Looper.h>
+#include <Messenger.h>
+#include <String.h>
+
+#include <deque>
+#include <vector>
+
+class BMessageRunner;
+class CommandLauncher;
+
+
+// Finds black borders by running ffmpeg's cropdetect filter over a few
+// short pieces spread over the source, several at the same time.
+// M_CROP_DETECT takes the "path", "duration" (seconds), "width" and
+// "height" of the source. The answer is an M_CROP_DETECTED with the median
+// of all pieces as "top", "bottom", "left" and "right" crop, the number of
+// pieces that had a result as "samples" and the time it took as "elapsed".
+// "timeout" tells if the time budget ran out before all pieces were done.
+// Without a usable result, the crop values are missing.
+class CropDetector : public BLooper {
+public:
+					CropDetector(BMessenger* target_messenger);
+					~CropDetector();
+
+	void 			MessageReceived(BMessage* message);
+
+private:
+	struct Crop {
+		int32		top;
+		int32		bottom;
+		int32		left;
+		int32		right;
+	};
+
+	void			_Dispatch();
+	void			_ParseOutput(int32 worker, const BString& data);
+	bool			_ParseCrop(const BString& line, Crop& crop);
+	void			_Finish();
+
+	BMessenger* 	fTargetMessenger;
+	BMessageRunner*	fTimeoutRunner;
+
+	BString			fSource;
+	int32			fWidth;
+	int32			fHeight;
+	bigtime_t		fStartTime;
+	bool			fTimedOut;
+
+	std::deque<int32> fQueue;
+
+	// one entry per worker: the output not yet split into lines, and the
+	// last crop cropdetect reported for the piece the worker is on
+	std::vector<CommandLauncher*> fWorkers;
+	std::vector<bool> fBusy;
+	std::vector<BString> fRest;
+	std::vector<Crop> fLastCrop;
+	std::vector<bool> fHasCrop;
+	int32			fRunning;
+
+	std::vector<Crop> fResults;
+};
+
+
+#endif // CROPDETECTOR_H
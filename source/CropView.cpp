@@ -13,17 +13,32 @@
 #include <TranslationUtils.h>
 #include <TranslatorFormats.h>
 
+#include <algorithm>
+#include <cmath>
+
 
 CropView::CropView()
 	:
 	BView("", B_SUPPORTS_LAYOUT | B_WILL_DRAW)
 {
+	fCurrentImage = nullptr;
+	fScaledImage = nullptr;
 	fImageLoaded = false;
 	fTopCrop = 0;
 	fBottomCrop = 0;
 	fLeftCrop = 0;
 	fRightCrop = 0;
 	fEnabled = false;
+	fMarkerVisible = false;
+	fDrawCount = 0;
+	fDrawTime = 0;
+}
+
+
+CropView::~CropView()
+{
+	delete fScaledImage;
+	delete fCurrentImage;
 }
 
 
@@ -32,11 +47,18 @@ CropView::Draw(BRect updateRect)
 {
 	if (fImageLoaded)
 	{
+		bigtime_t start = system_time();
+
+		// The image scaled to the view is kept, so spinner changes don't
+		// have to scale the full frame every time
 		SetDrawingMode(B_OP_COPY);
-		DrawBitmap(fCurrentImage, fCurrentImage->Bounds(), fDrawingRect);
+		if (fScaledImage != nullptr)
+			DrawBitmap(fScaledImage, fDrawingRect.LeftTop());
+		else
+			DrawBitmap(fCurrentImage, fCurrentImage->Bounds(), fDrawingRect);
 
 		// only draw crop marker when at least on cropping value is set
-		if ((fTopCrop + fBottomCrop + fLeftCrop + fRightCrop) > 0) {
+		if (_MarkerVisible()) {
 			SetHighColor(0,0,0);
 			SetLowColor(255,255,255);
 			StrokeRect(fMarkerRect, B_MIXED_COLORS);
@@ -48,6 +70,9 @@ CropView::Draw(BRect updateRect)
 			SetDrawingMode(B_OP_BLEND);
 			FillRect(fDrawingRect, B_SOLID_LOW);
 		}
+
+		fDrawCount++;
+		fDrawTime += system_time() - start;
 	}
 }
 
@@ -57,7 +82,9 @@ CropView::LayoutChanged()
 {
 	if (fImageLoaded) {
 		_SetDrawingRect();
+		_ScaleImage();
 		_SetMarkerRect();
+		Invalidate();
 	}
 }
 
@@ -65,21 +92,32 @@ CropView::LayoutChanged()
 status_t
 CropView::LoadImage(const char* path)
 {
-	fCurrentImage = BTranslationUtils::GetBitmap(path);
+	return SetImage(BTranslationUtils::GetBitmap(path));
+}
 
-	if (fCurrentImage != nullptr) {
-		if (fCurrentImage->IsValid()) {
-			fImageLoaded = true;
-			fImageSize = fCurrentImage->Bounds().Size();
 
-			_SetDrawingRect();
-			_SetMarkerRect();
-			Invalidate();
-			return B_OK;
-		}
+status_t
+CropView::SetImage(BBitmap* image)
+{
+	// takes ownership of the image
+	if (image == nullptr)
+		return B_ERROR;
+
+	if (!image->IsValid()) {
+		delete image;
+		return B_ERROR;
 	}
 
-	return B_ERROR;
+	delete fCurrentImage;
+	fCurrentImage = image;
+	fImageLoaded = true;
+	fImageSize = fCurrentImage->Bounds().Size();
+
+	_SetDrawingRect();
+	_ScaleImage();
+	_SetMarkerRect();
+	Invalidate();
+	return B_OK;
 }
 
 
@@ -87,7 +125,7 @@ void
 CropView::SetLeftCrop(int32 leftcrop)
 {
 	fLeftCrop = leftcrop;
-	_SetMarkerRect();
+	_UpdateMarker();
 }
 
 
@@ -95,7 +133,7 @@ void
 CropView::SetRightCrop(int32 rightcrop)
 {
 	fRightCrop = rightcrop;
-	_SetMarkerRect();
+	_UpdateMarker();
 }
 
 
@@ -103,7 +141,7 @@ void
 CropView::SetTopCrop(int32 topcrop)
 {
 	fTopCrop = topcrop;
-	_SetMarkerRect();
+	_UpdateMarker();
 }
 
 
@@ -111,7 +149,7 @@ void
 CropView::SetBottomCrop(int32 bottomcrop)
 {
 	fBottomCrop = bottomcrop;
-	_SetMarkerRect();
+	_UpdateMarker();
 }
 
 
@@ -145,6 +183,36 @@ CropView::_SetDrawingRect()
 }
 
 
+void
+CropView::_ScaleImage()
+{
+	delete fScaledImage;
+	fScaledImage = nullptr;
+
+	BRect bounds(0, 0, roundf(fDrawingRect.Width()), roundf(fDrawingRect.Height()));
+	if (!bounds.IsValid() || bounds.Width() < 1 || bounds.Height() < 1)
+		return;
+
+	fScaledImage = new BBitmap(bounds, B_RGB32, true);
+	if (!fScaledImage->IsValid()) {
+		delete fScaledImage;
+		fScaledImage = nullptr;
+		return;
+	}
+
+	BView* view = new BView(bounds, "scaler", B_FOLLOW_NONE, 0);
+	fScaledImage->AddChild(view);
+	if (fScaledImage->Lock()) {
+		view->DrawBitmap(fCurrentImage, fCurrentImage->Bounds(), bounds,
+			B_FILTER_BITMAP_BILINEAR);
+		view->Sync();
+		fScaledImage->RemoveChild(view);
+		fScaledImage->Unlock();
+	}
+	delete view;
+}
+
+
 void
 CropView::_SetMarkerRect()
 {
@@ -155,6 +223,53 @@ CropView::_SetMarkerRect()
 		fMarkerRect.left += fLeftCrop * fResizeFactor;
 		fMarkerRect.right -= fRightCrop * fResizeFactor;
 	}
+}
 
-	Invalidate();
+
+void
+CropView::_UpdateMarker()
+{
+	BRect old_marker = fMarkerRect;
+	bool old_visible = fMarkerVisible;
+	_SetMarkerRect();
+	fMarkerVisible = _MarkerVisible();
+
+	if (!fImageLoaded)
+		return;
+
+	// Showing or hiding the marker touches all its edges
+	if (old_visible != fMarkerVisible) {
+		Invalidate(old_marker | fMarkerRect);
+		return;
+	}
+	if (!fMarkerVisible)
+		return;
+
+	// Otherwise only the strip between the old and new position of a moved
+	// edge needs to be redrawn. It runs along the whole edge of both rects,
+	// which covers the lengthened or shortened neighbouring edges as well.
+	BRect both = old_marker | fMarkerRect;
+	if (old_marker.top != fMarkerRect.top) {
+		Invalidate(BRect(both.left, std::min(old_marker.top, fMarkerRect.top) - 1,
+			both.right, std::max(old_marker.top, fMarkerRect.top) + 1));
+	}
+	if (old_marker.bottom != fMarkerRect.bottom) {
+		Invalidate(BRect(both.left, std::min(old_marker.bottom, fMarkerRect.bottom) - 1,
+			both.right, std::max(old_marker.bottom, fMarkerRect.bottom) + 1));
+	}
+	if (old_marker.left != fMarkerRect.left) {
+		Invalidate(BRect(std::min(old_marker.left, fMarkerRect.left) - 1, both.top,
+			std::max(old_marker.left, fMarkerRect.left) + 1, both.bottom));
+	}
+	if (old_marker.right != fMarkerRect.right) {
+		Invalidate(BRect(std::min(old_marker.right, fMarkerRect.right) - 1, both.top,
+			std::max(old_marker.right, fMarkerRect.right) + 1, both.bottom));
+	}
+}
+
+
+bool
+CropView::_MarkerVisible()
+{
+	return (fTopCrop + fBottomCrop + fLeftCrop + fRightCrop) > 0;
 }
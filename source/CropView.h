@@ -19,11 +19,13 @@ class BString;
 class CropView : public BView {
 public:
 				CropView();
+				~CropView();
 
 	void		Draw(BRect updateRect);
 	void 		LayoutChanged();
 
 	status_t	LoadImage(const char* path);
+	status_t	SetImage(BBitmap* image);
 
 	void		SetLeftCrop(int32 leftcrop);
 	void		SetRightCrop(int32 rightcrop);
@@ -31,12 +33,19 @@ public:
 	void		SetBottomCrop(int32 bottomcrop);
 	void		SetEnabled(bool enabled);
 
+	// how often the view was drawn, and the time all that took
+	int32		DrawCount() const { return fDrawCount; }
+	bigtime_t	DrawTime() const { return fDrawTime; }
 
 private:
 	void		_SetDrawingRect();
+	void		_ScaleImage();
 	void 		_SetMarkerRect();
+	void		_UpdateMarker();
+	bool		_MarkerVisible();
 
 	BBitmap*	fCurrentImage;
+	BBitmap*	fScaledImage;
 	bool		fImageLoaded;
 	BSize		fImageSize;
 	BRect 		fDrawingRect;
@@ -48,6 +57,10 @@ private:
 	int32 		fTopCrop;
 	int32 		fBottomCrop;
 	bool 		fEnabled;
+	bool		fMarkerVisible;
+
+	int32		fDrawCount;
+	bigtime_t	fDrawTime;
 };
 
 #endif
@@ -0,0 +1,251 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+
+
+#include "EncodeSpec.h"
+#include "Utilities.h"
+
+
+static BString
+filter_name(const BString& filter)
+{
+	BString name;
+	int32 position = filter.FindFirst('=');
+	if (position == B_ERROR)
+		name = filter;
+	else
+		filter.CopyInto(name, 0, position);
+	return name.Trim();
+}
+
+
+static void
+split_filters(const BString& chain, BStringList& filters)
+{
+	// Filters are separated by commas, which may also be part of a filter's
+	// arguments when escaped or quoted
+	filters.MakeEmpty();
+
+	BString filter;
+	bool quoted = false;
+	for (int32 i = 0; i < chain.Length(); i++) {
+		char c = chain.ByteAt(i);
+		if (c == '\\' && i + 1 < chain.Length()) {
+			filter << c << chain.ByteAt(++i);
+			continue;
+		}
+		if (c == '\'')
+			quoted = !quoted;
+		if (c == ',' && !quoted) {
+			filters.Add(filter);
+			filter = "";
+		} else
+			filter += c;
+	}
+	if (!filter.IsEmpty())
+		filters.Add(filter);
+}
+
+
+EncodeSpec::EncodeSpec()
+	:
+	video_enabled(true),
+	audio_enabled(true),
+	stats(false)
+{
+}
+
+
+void
+EncodeSpec::Parse(const BString& commandline)
+{
+	*this = EncodeSpec();
+
+	BStringList tokens;
+	tokenize_commandline(commandline, tokens);
+	int32 count = tokens.CountStrings();
+	if (count == 0)
+		return;
+
+	program = tokens.StringAt(0);
+
+	// ffmpeg wants the output file at the end. The commandline of a job
+	// has "-y" after it, which is added again when a job is run.
+	int32 last = count;
+	while (last > 1 && (tokens.StringAt(last - 1) == "-y"
+			|| tokens.StringAt(last - 1) == "-n"))
+		last--;
+	if (last > 1 && !tokens.StringAt(last - 1).StartsWith("-")) {
+		output = tokens.StringAt(last - 1);
+		last--;
+	}
+
+	bool input_found = false;
+	for (int32 i = 1; i < last; i++) {
+		BString token = tokens.StringAt(i);
+		bool has_value = i + 1 < last;
+		BString value = has_value ? tokens.StringAt(i + 1) : "";
+
+		// everything in front of the input file applies to it
+		if (!input_found) {
+			if (token == "-i" && has_value) {
+				input = value;
+				input_found = true;
+				i++;
+			} else
+				input_options.Add(token);
+			continue;
+		}
+
+		BString* field = NULL;
+		if (token == "-f")
+			field = &format;
+		else if (token == "-vcodec" || token == "-c:v")
+			field = &video_codec;
+		else if (token == "-b:v")
+			field = &video_bitrate;
+		else if (token == "-r")
+			field = &framerate;
+		else if (token == "-s")
+			field = &size;
+		else if (token == "-acodec" || token == "-c:a")
+			field = &audio_codec;
+		else if (token == "-b:a")
+			field = &audio_bitrate;
+		else if (token == "-ar")
+			field = &samplerate;
+		else if (token == "-ac")
+			field = &channels;
+		else if (token == "-strict")
+			field = &strict;
+		else if (token == "-loglevel")
+			field = &loglevel;
+
+		if (field != NULL && has_value) {
+			*field = value;
+			i++;
+		} else if (token == "-vf" && has_value) {
+			split_filters(value, video_filters);
+			i++;
+		} else if (token == "-vn")
+			video_enabled = false;
+		else if (token == "-an")
+			audio_enabled = false;
+		else if (token == "-stats")
+			stats = true;
+		else
+			extra_options.Add(token);
+	}
+}
+
+
+void
+EncodeSpec::GetArguments(BStringList& arguments) const
+{
+	arguments.MakeEmpty();
+	arguments.Add(program);
+	arguments.Add(input_options);
+
+	if (!input.IsEmpty()) {
+		arguments.Add("-i");
+		arguments.Add(input);
+	}
+	if (!format.IsEmpty()) {
+		arguments.Add("-f");
+		arguments.Add(format);
+	}
+
+	if (!video_enabled)
+		arguments.Add("-vn");
+	else {
+		const char* names[] = { "-vcodec", "-b:v", "-r", "-s" };
+		const BString* values[] = { &video_codec, &video_bitrate, &framerate, &size };
+		for (int32 i = 0; i < 4; i++) {
+			if (!values[i]->IsEmpty()) {
+				arguments.Add(names[i]);
+				arguments.Add(*values[i]);
+			}
+		}
+		if (!video_filters.IsEmpty()) {
+			arguments.Add("-vf");
+			arguments.Add(video_filters.Join(","));
+		}
+	}
+
+	if (!audio_enabled)
+		arguments.Add("-an");
+	else {
+		const char* names[] = { "-acodec", "-b:a", "-ar", "-ac" };
+		const BString* values[] = { &audio_codec, &audio_bitrate, &samplerate, &channels };
+		for (int32 i = 0; i < 4; i++) {
+			if (!values[i]->IsEmpty()) {
+				arguments.Add(names[i]);
+				arguments.Add(*values[i]);
+			}
+		}
+	}
+
+	if (!strict.IsEmpty()) {
+		arguments.Add("-strict");
+		arguments.Add(strict);
+	}
+
+	arguments.Add(extra_options);
+
+	if (!loglevel.IsEmpty()) {
+		arguments.Add("-loglevel");
+		arguments.Add(loglevel);
+	}
+	if (stats)
+		arguments.Add("-stats");
+
+	if (!output.IsEmpty())
+		arguments.Add(output);
+}
+
+
+BString
+EncodeSpec::Commandline() const
+{
+	BStringList arguments;
+	GetArguments(arguments);
+
+	// Files are always quoted, so they're easy to spot
+	BString commandline;
+	for (int32 i = 0; i < arguments.CountStrings(); i++) {
+		const BString& argument = arguments.StringAt(i);
+		bool is_file = (i > 0 && arguments.StringAt(i - 1) == "-i" && argument == input)
+			|| (i == arguments.CountStrings() - 1 && argument == output);
+		if (i > 0)
+			commandline << " ";
+		commandline << quote_argument(argument, is_file);
+	}
+	return commandline;
+}
+
+
+void
+EncodeSpec::SetFilter(const BString& name, const BString& filter)
+{
+	for (int32 i = 0; i < video_filters.CountStrings(); i++) {
+		if (filter_name(video_filters.StringAt(i)) == name) {
+			video_filters.Replace(i, filter);
+			return;
+		}
+	}
+
+	// The filters the GUI sets refer to the source frame, so they go first
+	video_filters.Add(filter, 0);
+}
+
+
+void
+EncodeSpec::RemoveFilter(const BString& name)
+{
+	for (int32 i = video_filters.CountStrings() - 1; i >= 0; i--) {
+		if (filter_name(video_filters.StringAt(i)) == name)
+			video_filters.Remove(i);
+	}
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+#ifndef ENCODESPEC_H
+#define ENCODESPEC_H
+
+
+#include <String.h>
+#include <StringList.h>
+
+
+// The ffmpeg commandline as the options the GUI sets, plus whatever else
+// was typed into the commandline field, kept in order. Parsing and
+// rendering are done in one pass each, setting an option just assigns it.
+struct EncodeSpec {
+					EncodeSpec();
+
+	void			Parse(const BString& commandline);
+
+	// the arguments as they're passed to the program, unquoted
+	void			GetArguments(BStringList& arguments) const;
+	// quoted for the shell
+	BString			Commandline() const;
+
+	void			SetFilter(const BString& name, const BString& filter);
+	void			RemoveFilter(const BString& name);
+
+	BString			program;
+	BStringList		input_options;
+	BString			input;
+	BString			format;
+
+	bool			video_enabled;
+	BString			video_codec;
+	BString			video_bitrate;
+	BString			framerate;
+	BString			size;
+	BStringList		video_filters;
+
+	bool			audio_enabled;
+	BString			audio_codec;
+	BString			audio_bitrate;
+	BString			samplerate;
+	BString			channels;
+
+	BString			strict;
+	BString			loglevel;
+	bool			stats;
+
+	// options of the commandline field the GUI doesn't know about
+	BStringList		extra_options;
+	BString			output;
+};
+
+
+#endif // ENCODESPEC_H
@@ -0,0 +1,302 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+
+
+#include "ErrorMatcher.h"
+
+#include <Catalog.h>
+#include <File.h>
+#include <FindDirectory.h>
+#include <Path.h>
+#include <StringList.h>
+
+#include <algorithm>
+#include <deque>
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "ErrorMatcher"
+
+
+static const struct {
+	const char*	text;
+	int32		action;
+	int32		error;
+} kDefaultPatterns[] = {
+	{ "Error while decoding stream", PATTERN_ABORT, ERROR_DECODING },
+	{ "No space left on device", PATTERN_ABORT, ERROR_DISK_FULL },
+	{ "Invalid data found when processing input", PATTERN_FLAG, ERROR_INVALID_DATA },
+	{ "No such file or directory", PATTERN_FLAG, ERROR_NO_SUCH_FILE },
+	{ "Permission denied", PATTERN_FLAG, ERROR_PERMISSION_DENIED },
+	{ "Unknown encoder", PATTERN_FLAG, ERROR_UNKNOWN_CODEC },
+	{ "Unknown decoder", PATTERN_FLAG, ERROR_UNKNOWN_CODEC },
+	{ "Unrecognized option", PATTERN_FLAG, ERROR_INVALID_ARGUMENT },
+	{ "Invalid argument", PATTERN_FLAG, ERROR_INVALID_ARGUMENT },
+	{ "Error opening output file", PATTERN_FLAG, ERROR_OUTPUT },
+	{ "Could not write header", PATTERN_FLAG, ERROR_OUTPUT },
+	{ "Conversion failed!", PATTERN_FLAG, ERROR_CONVERSION },
+	{ "Non-monotonous DTS", PATTERN_IGNORE, ERROR_NONE },
+	{ "Past duration", PATTERN_IGNORE, ERROR_NONE }
+};
+
+static const char* kErrorNames[] = {
+	"none",
+	"decoding",
+	"invalid_data",
+	"no_such_file",
+	"permission_denied",
+	"disk_full",
+	"unknown_codec",
+	"invalid_argument",
+	"output",
+	"conversion",
+	"other"
+};
+
+static const char* kActionNames[] = {
+	"ignore",
+	"flag",
+	"abort"
+};
+
+static const int32 kAlphabetSize = 256;
+static const uint16 kNoState = 0xffff;
+
+
+ErrorMatcher::ErrorMatcher()
+{
+	Reset();
+}
+
+
+void
+ErrorMatcher::Reset()
+{
+	fState = 0;
+	fError = ERROR_NONE;
+	fAborted = false;
+	fFlagged = 0;
+}
+
+
+int32
+ErrorMatcher::Feed(const char* data, size_t length)
+{
+	const Automaton& automaton = _Automaton();
+	const uint16* transitions = automaton.transitions.data();
+	const int32* matches = automaton.matches.data();
+
+	int32 action = PATTERN_IGNORE;
+	uint16 state = fState;
+	for (size_t i = 0; i < length; i++) {
+		state = transitions[state * kAlphabetSize + (uint8)data[i]];
+		if (matches[state] < 0)
+			continue;
+
+		const Pattern& pattern = automaton.patterns[matches[state]];
+		if (pattern.action == PATTERN_FLAG) {
+			fFlagged++;
+			if (fError == ERROR_NONE)
+				fError = pattern.error;
+		} else if (pattern.action == PATTERN_ABORT && !fAborted) {
+			fAborted = true;
+			fError = pattern.error;
+		}
+		action = std::max(action, pattern.action);
+	}
+	fState = state;
+	return action;
+}
+
+
+const char*
+ErrorMatcher::ErrorName(int32 error)
+{
+	if (error < ERROR_NONE || error > ERROR_OTHER)
+		error = ERROR_OTHER;
+	return kErrorNames[error];
+}
+
+
+BString
+ErrorMatcher::ErrorDescription(int32 error)
+{
+	switch (error) {
+		case ERROR_NONE:
+			return "";
+		case ERROR_DECODING:
+			return B_TRANSLATE("Error while decoding");
+		case ERROR_INVALID_DATA:
+			return B_TRANSLATE("Invalid data in the source");
+		case ERROR_NO_SUCH_FILE:
+			return B_TRANSLATE("File not found");
+		case ERROR_PERMISSION_DENIED:
+			return B_TRANSLATE("Permission denied");
+		case ERROR_DISK_FULL:
+			return B_TRANSLATE("Disk full");
+		case ERROR_UNKNOWN_CODEC:
+			return B_TRANSLATE("Unknown codec");
+		case ERROR_INVALID_ARGUMENT:
+			return B_TRANSLATE("Invalid option");
+		case ERROR_OUTPUT:
+			return B_TRANSLATE("Couldn't write the output file");
+		case ERROR_CONVERSION:
+			return B_TRANSLATE("Conversion failed");
+		default:
+			return B_TRANSLATE("Unknown error");
+	}
+}
+
+
+const ErrorMatcher::Automaton&
+ErrorMatcher::_Automaton()
+{
+	// Built when it's first used, by any of the launchers
+	static const Automaton* automaton = []() {
+		Automaton* result = new Automaton;
+		_LoadPatterns(result->patterns);
+		_Compile(*result);
+		return result;
+	}();
+	return *automaton;
+}
+
+
+void
+ErrorMatcher::_LoadPatterns(std::vector<Pattern>& patterns)
+{
+	for (size_t i = 0; i < B_COUNT_OF(kDefaultPatterns); i++) {
+		Pattern pattern;
+		pattern.text = kDefaultPatterns[i].text;
+		pattern.action = kDefaultPatterns[i].action;
+		pattern.error = kDefaultPatterns[i].error;
+		patterns.push_back(pattern);
+	}
+
+	BPath path;
+	if (find_directory(B_USER_SETTINGS_DIRECTORY, &path) != B_OK
+		|| path.Append("ffmpegGUI/error_patterns") != B_OK)
+		return;
+
+	BFile file(path.Path(), B_READ_ONLY);
+	off_t size;
+	if (file.InitCheck() != B_OK || file.GetSize(&size) != B_OK || size > 65536)
+		return;
+
+	BString contents;
+	char* buffer = contents.LockBuffer(size + 1);
+	ssize_t amount_read = file.Read(buffer, size);
+	contents.UnlockBuffer(std::max(amount_read, (ssize_t)0));
+
+	BStringList lines;
+	contents.Split("\n", true, lines);
+	for (int32 i = 0; i < lines.CountStrings(); i++) {
+		// <action> <error name> <text>, the text may contain spaces
+		BString line = lines.StringAt(i);
+		line.Trim();
+		if (line.IsEmpty() || line.StartsWith("#"))
+			continue;
+
+		int32 first = line.FindFirst(' ');
+		int32 second = (first == B_ERROR) ? B_ERROR : line.FindFirst(' ', first + 1);
+		if (second == B_ERROR)
+			continue;
+
+		BString action_name, error_name, text;
+		line.CopyInto(action_name, 0, first);
+		line.CopyInto(error_name, first + 1, second - first - 1);
+		line.CopyInto(text, second + 1, line.Length() - second - 1);
+		text.Trim();
+
+		Pattern pattern;
+		pattern.text = text;
+		pattern.action = -1;
+		pattern.error = ERROR_OTHER;
+		for (int32 j = 0; j < (int32)B_COUNT_OF(kActionNames); j++) {
+			if (action_name.ICompare(kActionNames[j]) == 0)
+				pattern.action = j;
+		}
+		for (int32 j = 0; j < (int32)B_COUNT_OF(kErrorNames); j++) {
+			if (error_name.ICompare(kErrorNames[j]) == 0)
+				pattern.error = j;
+		}
+		if (pattern.action < 0 || text.IsEmpty())
+			continue;
+
+		// a line for a message that's already known replaces it
+		std::vector<Pattern>::iterator known = patterns.begin();
+		while (known != patterns.end() && known->text != text)
+			known++;
+		if (known != patterns.end())
+			*known = pattern;
+		else
+			patterns.push_back(pattern);
+	}
+}
+
+
+void
+ErrorMatcher::_Compile(Automaton& automaton)
+{
+	std::vector<uint16>& transitions = automaton.transitions;
+	std::vector<int32>& matches = automaton.matches;
+
+	// the trie of all patterns, as long as the states fit
+	transitions.assign(kAlphabetSize, kNoState);
+	matches.assign(1, -1);
+	for (size_t i = 0; i < automaton.patterns.size(); i++) {
+		const BString& text = automaton.patterns[i].text;
+		if (matches.size() + text.Length() >= kNoState)
+			break;
+
+		uint16 state = 0;
+		for (int32 j = 0; j < text.Length(); j++) {
+			uint16& next = transitions[state * kAlphabetSize + (uint8)text.ByteAt(j)];
+			if (next == kNoState) {
+				next = matches.size();
+				transitions.resize(transitions.size() + kAlphabetSize, kNoState);
+				matches.push_back(-1);
+			}
+			state = transitions[state * kAlphabetSize + (uint8)text.ByteAt(j)];
+		}
+		if (matches[state] < 0
+			|| automaton.patterns[matches[state]].action < automaton.patterns[i].action)
+			matches[state] = i;
+	}
+
+	// Breadth first, every missing transition is taken from the state of
+	// the longest suffix that is also a prefix. A state also matches what
+	// that suffix matches, only the most severe pattern is kept.
+	std::vector<uint16> failure(matches.size(), 0);
+	std::deque<uint16> queue;
+	for (int32 c = 0; c < kAlphabetSize; c++) {
+		uint16& next = transitions[c];
+		if (next == kNoState)
+			next = 0;
+		else
+			queue.push_back(next);
+	}
+
+	while (!queue.empty()) {
+		uint16 state = queue.front();
+		queue.pop_front();
+
+		int32 suffix_match = matches[failure[state]];
+		if (suffix_match >= 0 && (matches[state] < 0
+				|| automaton.patterns[matches[state]].action
+					< automaton.patterns[suffix_match].action))
+			matches[state] = suffix_match;
+
+		for (int32 c = 0; c < kAlphabetSize; c++) {
+			uint16& next = transitions[state * kAlphabetSize + c];
+			uint16 fallback = transitions[failure[state] * kAlphabetSize + c];
+			if (next == kNoState)
+				next = fallback;
+			else {
+				failure[next] = fallback;
+				queue.push_back(next);
+			}
+		}
+	}
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+#ifndef ERRORMATCHER_H
+#define ERRORMATCHER_H
+
+
+#include <String.h>
+#include <SupportDefs.h>
+
+#include <vector>
+
+
+// What happens when a pattern shows up in the output
+enum {
+	PATTERN_IGNORE = 0,	// known to be harmless
+	PATTERN_FLAG,		// remembered, ffmpeg decides if it's fatal
+	PATTERN_ABORT		// the command is stopped and has failed
+};
+
+// Kinds of failures, passed as "error" with the finish message
+enum {
+	ERROR_NONE = 0,
+	ERROR_DECODING,
+	ERROR_INVALID_DATA,
+	ERROR_NO_SUCH_FILE,
+	ERROR_PERMISSION_DENIED,
+	ERROR_DISK_FULL,
+	ERROR_UNKNOWN_CODEC,
+	ERROR_INVALID_ARGUMENT,
+	ERROR_OUTPUT,
+	ERROR_CONVERSION,
+	ERROR_OTHER
+};
+
+
+// Looks for a table of error messages in ffmpeg's output, all patterns
+// at once and a byte at a time, so a message split over two reads is
+// still found. The table is the built-in one, changed by the lines of the
+// "error_patterns" file in the settings folder:
+//	<abort|flag|ignore> <error name> <text of the message>
+// It's compiled once into an Aho-Corasick automaton all matchers share,
+// a matcher only keeps its state in it.
+class ErrorMatcher {
+public:
+					ErrorMatcher();
+
+	void			Reset();
+
+	// Returns the most severe action of the patterns found in this data
+	int32			Feed(const char* data, size_t length);
+
+	// of the first pattern to abort, or else the first one flagged
+	int32			Error() const { return fError; }
+	int32			Flagged() const { return fFlagged; }
+
+	static const char*	ErrorName(int32 error);
+	static BString	ErrorDescription(int32 error);
+
+private:
+	struct Pattern {
+		BString		text;
+		int32		action;
+		int32		error;
+	};
+
+	struct Automaton {
+		// next state for every state and byte
+		std::vector<uint16>	transitions;
+		// the pattern ending in a state, the most severe if several do
+		std::vector<int32>	matches;
+		std::vector<Pattern> patterns;
+	};
+
+	static const Automaton&	_Automaton();
+	static void		_LoadPatterns(std::vector<Pattern>& patterns);
+	static void		_Compile(Automaton& automaton);
+
+	uint16			fState;
+	int32			fError;
+	bool			fAborted;
+	int32			fFlagged;
+};
+
+
+#endif // ERRORMATCHER_H
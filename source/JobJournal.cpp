@@ -0,0 +1,308 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+
+
+#include "JobJournal.h"
+#include "JobList.h"
+
+#include <DataIO.h>
+#include <Directory.h>
+#include <Entry.h>
+#include <FindDirectory.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+
+// Kinds of records
+enum {
+	kAddRecord = 'jadd',
+	kRemoveRecord = 'jrem',
+	kSwapRecord = 'jswp',
+	kStatusRecord = 'jsta',
+	kScheduleRecord = 'jsch',
+	kClearRecord = 'jclr'
+};
+
+// The log is compacted when it has that many more records than jobs
+static const int32 kMaxExtraRecords = 1000;
+
+
+JobJournal::JobJournal()
+	:
+	fRecordCount(0),
+	fDirty(false)
+{
+	if (find_directory(B_USER_SETTINGS_DIRECTORY, &fPath) == B_OK) {
+		fPath.Append("ffmpegGUI");
+		create_directory(fPath.Path(), 0777);
+		fPath.Append("jobs_journal");
+	}
+}
+
+
+status_t
+JobJournal::Replay(BMessage& jobs)
+{
+	BFile file(fPath.Path(), B_READ_ONLY);
+	off_t size;
+	status_t status = file.GetSize(&size);
+	if (status != B_OK)
+		return status;
+
+	// Reading it all at once is much faster than unflattening from the file
+	char* buffer = (char*)malloc(size);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	if (file.Read(buffer, size) != size) {
+		free(buffer);
+		return B_IO_ERROR;
+	}
+
+	// Removed jobs leave a hole in the order, so every record is applied in
+	// constant time
+	std::vector<BMessage*> order;
+	std::unordered_map<int32, size_t> positions;
+	int32 records = 0;
+
+	BMemoryIO input(buffer, size);
+	while (input.Position() < size) {
+		BMessage* record = new BMessage();
+		// the tail may be cut short by a crash
+		if (record->Unflatten(&input) != B_OK) {
+			delete record;
+			break;
+		}
+		records++;
+
+		int32 id = record->GetInt32("id", -1);
+		std::unordered_map<int32, size_t>::iterator found = positions.find(id);
+		switch (record->what) {
+			case kAddRecord:
+			{
+				if (found != positions.end()) {
+					delete order[found->second];
+					order[found->second] = NULL;
+				}
+				positions[id] = order.size();
+				order.push_back(record);
+				continue;
+			}
+			case kStatusRecord:
+			{
+				int32 statusID = record->GetInt32("status", WAITING);
+				if ((statusID == WAITING) or (statusID == RUNNING))
+					break;
+				// fall through, a job that's done isn't queued anymore
+			}
+			case kRemoveRecord:
+			{
+				if (found == positions.end())
+					break;
+				delete order[found->second];
+				order[found->second] = NULL;
+				positions.erase(found);
+				break;
+			}
+			case kSwapRecord:
+			{
+				std::unordered_map<int32, size_t>::iterator other
+					= positions.find(record->GetInt32("other", -1));
+				if (found == positions.end() || other == positions.end())
+					break;
+				std::swap(order[found->second], order[other->second]);
+				std::swap(found->second, other->second);
+				break;
+			}
+			case kScheduleRecord:
+			{
+				if (found == positions.end())
+					break;
+				BMessage* job = order[found->second];
+				job->SetInt32("priority", record->GetInt32("priority", PRIORITY_NORMAL));
+				job->SetInt64("deadline", record->GetInt64("deadline", 0));
+				break;
+			}
+			case kClearRecord:
+			{
+				for (BMessage* job : order)
+					delete job;
+				order.clear();
+				positions.clear();
+				break;
+			}
+		}
+		delete record;
+	}
+	free(buffer);
+
+	for (BMessage* job : order) {
+		if (job == NULL)
+			continue;
+
+		BMessage jobmessage;
+		job->FindMessage("jobmessage", &jobmessage);
+		jobs.AddString("filename", job->GetString("filename", ""));
+		jobs.AddString("duration", job->GetString("duration", ""));
+		jobs.AddString("command", job->GetString("command", ""));
+		jobs.AddMessage("jobmessage", &jobmessage);
+		jobs.AddInt32("priority", job->GetInt32("priority", PRIORITY_NORMAL));
+		jobs.AddInt64("deadline", job->GetInt64("deadline", 0));
+		delete job;
+	}
+	jobs.AddInt32("records", records);
+	return B_OK;
+}
+
+
+status_t
+JobJournal::Compact(const BMessage& jobs)
+{
+	// The new log replaces the old one only once it's completely on disk
+	BPath newPath(fPath);
+	newPath.GetParent(&newPath);
+	newPath.Append("jobs_journal.new");
+
+	BFile file;
+	status_t status = file.SetTo(newPath.Path(),
+		B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	if (status != B_OK)
+		return status;
+
+	BMallocIO output;
+	int32 count = 0;
+	int32 id;
+	while (jobs.FindInt32("id", count, &id) == B_OK) {
+		BMessage jobmessage;
+		jobs.FindMessage("jobmessage", count, &jobmessage);
+
+		BMessage record(kAddRecord);
+		record.AddInt32("id", id);
+		record.AddString("filename", jobs.GetString("filename", count, ""));
+		record.AddString("duration", jobs.GetString("duration", count, ""));
+		record.AddString("command", jobs.GetString("command", count, ""));
+		record.AddMessage("jobmessage", &jobmessage);
+		record.AddInt32("priority", jobs.GetInt32("priority", count, PRIORITY_NORMAL));
+		record.AddInt64("deadline", jobs.GetInt64("deadline", count, 0));
+		record.Flatten(&output);
+		count++;
+	}
+
+	if (file.Write(output.Buffer(), output.BufferLength()) != (ssize_t)output.BufferLength())
+		return B_IO_ERROR;
+	status = file.Sync();
+	if (status != B_OK)
+		return status;
+
+	status = BEntry(newPath.Path()).Rename(fPath.Path(), true);
+	if (status != B_OK)
+		return status;
+
+	fRecordCount = count;
+	fDirty = false;
+	return fFile.SetTo(fPath.Path(), B_WRITE_ONLY | B_OPEN_AT_END);
+}
+
+
+bool
+JobJournal::NeedsCompaction(int32 jobCount) const
+{
+	return fRecordCount > 2 * jobCount + kMaxExtraRecords;
+}
+
+
+status_t
+JobJournal::Sync()
+{
+	if (!fDirty)
+		return B_OK;
+
+	fDirty = false;
+	return fFile.Sync();
+}
+
+
+void
+JobJournal::AddJob(int32 id, const char* filename, const char* duration,
+	const char* commandline, const BMessage& jobmessage)
+{
+	BMessage record(kAddRecord);
+	record.AddInt32("id", id);
+	record.AddString("filename", filename);
+	record.AddString("duration", duration);
+	record.AddString("command", commandline);
+	record.AddMessage("jobmessage", &jobmessage);
+	_Append(record);
+}
+
+
+void
+JobJournal::RemoveJob(int32 id)
+{
+	BMessage record(kRemoveRecord);
+	record.AddInt32("id", id);
+	_Append(record);
+}
+
+
+void
+JobJournal::SwapJobs(int32 id, int32 otherID)
+{
+	BMessage record(kSwapRecord);
+	record.AddInt32("id", id);
+	record.AddInt32("other", otherID);
+	_Append(record);
+}
+
+
+void
+JobJournal::SetStatus(int32 id, int32 statusID, bigtime_t elapsed)
+{
+	BMessage record(kStatusRecord);
+	record.AddInt32("id", id);
+	record.AddInt32("status", statusID);
+	if (elapsed >= 0)
+		record.AddInt64("elapsed", elapsed);
+	_Append(record);
+}
+
+
+void
+JobJournal::SetSchedule(int32 id, int32 priority, time_t deadline)
+{
+	BMessage record(kScheduleRecord);
+	record.AddInt32("id", id);
+	record.AddInt32("priority", priority);
+	record.AddInt64("deadline", deadline);
+	_Append(record);
+}
+
+
+void
+JobJournal::Clear()
+{
+	BMessage record(kClearRecord);
+	_Append(record);
+}
+
+
+void
+JobJournal::_Append(const BMessage& record)
+{
+	// nothing is written before the log was started by Compact()
+	if (fFile.InitCheck() != B_OK)
+		return;
+
+	// flattened first, so the record goes to the file in one write
+	BMallocIO output;
+	if (record.Flatten(&output) != B_OK)
+		return;
+
+	fFile.Write(output.Buffer(), output.BufferLength());
+	fRecordCount++;
+	fDirty = true;
+}
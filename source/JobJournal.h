@@ -0,0 +1,54 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+#ifndef JOBJOURNAL_H
+#define JOBJOURNAL_H
+
+
+#include <File.h>
+#include <Message.h>
+#include <Path.h>
+#include <SupportDefs.h>
+
+
+// The queue of the job manager, kept as a log of the changes to it in the
+// settings folder. Every change is appended as a small flattened BMessage
+// right away; they're synced to disk in batches by calling Sync() now and
+// then. Replaying the log gives back the jobs that weren't done yet, in
+// the same archive the "jobs" file of older versions had. Compacting
+// replaces the log with one record per job.
+// Jobs are named by an ID that has to be unique as long as they're queued.
+class JobJournal {
+public:
+					JobJournal();
+
+	// Fills "jobs" with the "filename", "duration", "command",
+	// "jobmessage", "priority" and "deadline" of each job, and "records"
+	// with the number read
+	status_t		Replay(BMessage& jobs);
+	// Starts a new log with the jobs given like above, plus their "id"
+	status_t		Compact(const BMessage& jobs);
+	bool			NeedsCompaction(int32 jobCount) const;
+	status_t		Sync();
+
+	void			AddJob(int32 id, const char* filename, const char* duration,
+						const char* commandline, const BMessage& jobmessage);
+	void			RemoveJob(int32 id);
+	void			SwapJobs(int32 id, int32 otherID);
+	// Done jobs aren't replayed, the metrics are only recorded
+	void			SetStatus(int32 id, int32 statusID, bigtime_t elapsed = -1);
+	void			SetSchedule(int32 id, int32 priority, time_t deadline);
+	void			Clear();
+
+private:
+	void			_Append(const BMessage& record);
+
+	BPath			fPath;
+	BFile			fFile;
+	int32			fRecordCount;
+	bool			fDirty;
+};
+
+
+#endif // JOBJOURNAL_H
@@ -7,12 +7,15 @@
 
 
 #include "JobList.h"
+#include "ErrorMatcher.h"
 #include "Utilities.h"
 
 #include <Catalog.h>
 #include <StringList.h>
 
+#include <algorithm>
 #include <stdio.h>
+#include <time.h>
 
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "JobList"
@@ -21,8 +24,170 @@
 // Job list view
 JobList::JobList()
 	:
-	BColumnListView("Joblist", 0, B_FANCY_BORDER, false)
+	BColumnListView("Joblist", 0, B_FANCY_BORDER, false),
+	fNextSequence(0)
 {
+	for (int32 i = 0; i < kStatusCount; i++)
+		fStatusCounts[i] = 0;
+}
+
+
+void
+JobList::AddJob(JobRow* row)
+{
+	AddRow(row);
+	fCommandLines[row->GetCommandLine()] = row;
+	fFilenames[row->GetFilename()] = row;
+	fStatusCounts[row->GetStatus()]++;
+	row->fList = this;
+	row->fSequence = fNextSequence++;
+	if (row->GetStatus() == WAITING)
+		fWaiting.insert(row);
+}
+
+
+void
+JobList::RemoveJob(JobRow* row)
+{
+	RemoveRow(row);
+	fCommandLines.erase(row->GetCommandLine());
+	fFilenames.erase(row->GetFilename());
+	fStatusCounts[row->GetStatus()]--;
+	fWaiting.erase(row);
+	row->fList = NULL;
+	// also removes the spill file of its log
+	delete row;
+}
+
+
+void
+JobList::ClearJobs()
+{
+	Clear();
+	fCommandLines.clear();
+	fFilenames.clear();
+	fWaiting.clear();
+	for (int32 i = 0; i < kStatusCount; i++)
+		fStatusCounts[i] = 0;
+}
+
+
+JobRow*
+JobList::FindCommandLine(const char* commandline)
+{
+	RowIndex::iterator found = fCommandLines.find(commandline);
+	return (found != fCommandLines.end()) ? found->second : NULL;
+}
+
+
+JobRow*
+JobList::FindFilename(const char* filename)
+{
+	RowIndex::iterator found = fFilenames.find(filename);
+	return (found != fFilenames.end()) ? found->second : NULL;
+}
+
+
+JobRow*
+JobList::NextWaitingJob()
+{
+	return fWaiting.empty() ? NULL : *fWaiting.begin();
+}
+
+
+void
+JobList::SetPolicy(int32 policy)
+{
+	WaitingSet waiting(fWaiting.begin(), fWaiting.end(), WaitingOrder(policy));
+	fWaiting.swap(waiting);
+}
+
+
+void
+JobList::SetPriority(JobRow* row, int32 priority)
+{
+	// a job has to leave the set before what it's ordered by changes
+	fWaiting.erase(row);
+	row->fPriority = priority;
+	if (row->GetStatus() == WAITING)
+		fWaiting.insert(row);
+}
+
+
+void
+JobList::SetDeadline(JobRow* row, time_t deadline)
+{
+	fWaiting.erase(row);
+	row->fDeadline = deadline;
+	// puts a waiting job back in order, and shows its deadline
+	row->SetStatus(row->GetStatus());
+}
+
+
+void
+JobList::SetPredictedCost(JobRow* row, float cost)
+{
+	fWaiting.erase(row);
+	row->fPredictedCost = cost;
+	if (row->GetStatus() == WAITING)
+		fWaiting.insert(row);
+}
+
+
+void
+JobList::SwapJobs(int32 index, int32 otherIndex)
+{
+	// The list order is the order of the sequence numbers
+	JobRow* row = dynamic_cast<JobRow*>(RowAt(index));
+	JobRow* other = dynamic_cast<JobRow*>(RowAt(otherIndex));
+	fWaiting.erase(row);
+	fWaiting.erase(other);
+	std::swap(row->fSequence, other->fSequence);
+	if (row->GetStatus() == WAITING)
+		fWaiting.insert(row);
+	if (other->GetStatus() == WAITING)
+		fWaiting.insert(other);
+
+	SwapRows(index, otherIndex);
+}
+
+
+bool
+JobList::WaitingOrder::operator()(JobRow* row, JobRow* other) const
+{
+	switch (policy) {
+		case SCHEDULE_PRIORITY:
+			if (row->GetPriority() != other->GetPriority())
+				return row->GetPriority() > other->GetPriority();
+			break;
+		case SCHEDULE_SHORTEST:
+			if (row->GetPredictedCost() != other->GetPredictedCost())
+				return row->GetPredictedCost() < other->GetPredictedCost();
+			break;
+		case SCHEDULE_DEADLINE:
+			// jobs without a deadline come last
+			if (row->GetDeadline() != other->GetDeadline()) {
+				if (row->GetDeadline() == 0 || other->GetDeadline() == 0)
+					return other->GetDeadline() == 0;
+				return row->GetDeadline() < other->GetDeadline();
+			}
+			break;
+	}
+
+	// otherwise as they're listed
+	return row->fSequence < other->fSequence;
+}
+
+
+void
+JobList::_StatusChanged(JobRow* row, int32 statusID)
+{
+	fStatusCounts[row->GetStatus()]--;
+	fStatusCounts[statusID]++;
+
+	fWaiting.erase(row);
+	if (statusID == WAITING)
+		fWaiting.insert(row);
 }
 
 
@@ -36,7 +201,16 @@ JobRow::JobRow(int32 jobnumber, const char* filename, const char* duration,
 	fDuration(duration),
 	fCommandLine(commandline),
 	fJobMessage(jobmessage),
-	fStatusID(statusID)
+	fStatusID(statusID),
+	fError(ERROR_NONE),
+	fPartialTime(0),
+	fPaused(false),
+	fRecoveredTime(0),
+	fList(NULL),
+	fSequence(0),
+	fPriority(PRIORITY_NORMAL),
+	fDeadline(0),
+	fPredictedCost(0)
 {
 	BStringList name;
 	fFilename.Split("/", true, name);
@@ -58,20 +232,47 @@ JobRow::SetStatus(int32 statusID)
 	switch (statusID) {
 		case WAITING:
 			fStatus = B_TRANSLATE("Waiting");
+			if (fDeadline > 0) {
+				char time[32];
+				struct tm local;
+				strftime(time, sizeof(time), "%a %H:%M", localtime_r(&fDeadline, &local));
+				BString due(B_TRANSLATE("due %time%"));
+				due.ReplaceFirst("%time%", time);
+				fStatus << ", " << due;
+			}
 			break;
 		case RUNNING:
 			fStatus = B_TRANSLATE("Running");
 			break;
 		case FINISHED:
 			fStatus = B_TRANSLATE("Finished");
+			if (fRecoveredTime > 0) {
+				char time[16];
+				seconds_to_string(fRecoveredTime / 1000000, time, sizeof(time));
+				BString recovered(B_TRANSLATE("%time% recovered"));
+				recovered.ReplaceFirst("%time%", time);
+				fStatus << " (" << recovered << ")";
+			}
 			break;
 		case ERROR:
 			fStatus = B_TRANSLATE("Error");
+			if (fError != ERROR_NONE)
+				fStatus << ": " << ErrorMatcher::ErrorDescription(fError);
+			break;
+		case PARTIAL:
+		{
+			char time[16];
+			seconds_to_string(fPartialTime / 1000000, time, sizeof(time));
+			fStatus = B_TRANSLATE("Partial, playable up to %time%");
+			fStatus.ReplaceFirst("%time%", time);
 			break;
+		}
 		default:
 			return;
 	}
 	SetField(new BStringField(fStatus.String()), kStatusIndex);
+	if (fList != NULL)
+		fList->_StatusChanged(this, statusID);
 	fStatusID = statusID;
 }
 
@@ -83,7 +284,7 @@ JobRow::SetStatus(BString status)
 }
 
 
-void JobRow::AddToLog(BString log)
+void JobRow::AddToLog(const BString& log)
 {
-	fLog << log;
+	fLog.Append(log.String(), log.Length());
 }
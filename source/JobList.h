@@ -8,9 +8,15 @@
 #define JOBLIST_H
 
 
+#include "LogStore.h"
+
 #include <ColumnListView.h>
 #include <ColumnTypes.h>
 
+#include <set>
+#include <string>
+#include <unordered_map>
+
 // Column indexes
 const int32 kJobNumberIndex = 0;
 const int32 kJobNameIndex = 1;
@@ -23,11 +29,76 @@ enum {
 	RUNNING,
 	FINISHED,
 	ERROR,
+	PARTIAL,	// aborted, but the output is playable up to some point
+	kStatusCount
+};
+
+// Order in which waiting jobs are started
+enum {
+	SCHEDULE_FIFO = 0,		// as they're listed
+	SCHEDULE_PRIORITY,
+	SCHEDULE_SHORTEST,		// least predicted encoding time first
+	SCHEDULE_DEADLINE		// earliest deadline first
 };
 
+// Job priority
+enum {
+	PRIORITY_LOW = -1,
+	PRIORITY_NORMAL,
+	PRIORITY_HIGH
+};
+
+class JobRow;
+
 class JobList : public BColumnListView {
 public:
 					JobList();
+
+	// Jobs are added and removed with these, to keep the lookup of the
+	// commandlines and output files, which are unique, up to date. The
+	// list owns the rows, removed ones are deleted.
+	void			AddJob(JobRow* row);
+	void			RemoveJob(JobRow* row);
+	void			ClearJobs();
+
+	JobRow*			FindCommandLine(const char* commandline);
+	JobRow*			FindFilename(const char* filename);
+
+	// kept up to date by JobRow::SetStatus()
+	int32			CountJobs(int32 statusID) { return fStatusCounts[statusID]; };
+
+	// The waiting jobs are kept ordered by the scheduling policy, so the
+	// next one is found right away. What they're ordered by is only
+	// changed through the list.
+	JobRow*			NextWaitingJob();
+	void			SetPolicy(int32 policy);
+	int32			Policy() { return fWaiting.key_comp().policy; };
+	void			SetPriority(JobRow* row, int32 priority);
+	void			SetDeadline(JobRow* row, time_t deadline);
+	// encoding time expected from the duration and the video codec
+	void			SetPredictedCost(JobRow* row, float cost);
+	void			SwapJobs(int32 index, int32 otherIndex);
+
+private:
+	friend class JobRow;
+
+	struct WaitingOrder {
+						WaitingOrder(int32 policy = SCHEDULE_FIFO) : policy(policy) {}
+		bool			operator()(JobRow* row, JobRow* other) const;
+
+		int32			policy;
+	};
+
+	void			_StatusChanged(JobRow* row, int32 statusID);
+
+	typedef std::unordered_map<std::string, JobRow*> RowIndex;
+	typedef std::set<JobRow*, WaitingOrder> WaitingSet;
+
+	RowIndex		fCommandLines;
+	RowIndex		fFilenames;
+	int32			fStatusCounts[kStatusCount];
+	WaitingSet		fWaiting;
+	int32			fNextSequence;
 };
 
 
@@ -44,23 +115,50 @@ public:
 	const char*		GetCommandLine() { return fCommandLine.String(); };
 	BMessage		GetJobMessage() { return fJobMessage; };
 	int32			GetStatus() { return fStatusID; };
-	const char*		GetLog() { return fLog.String(); };
+	const LogStore&	GetLog() { return fLog; };
 
 	void			SetStatus(int32 statusID);
 	void			SetStatus(BString status);
-	void			AddToLog(BString log);
+	// the kind of failure shown with the ERROR status
+	void			SetError(int32 error) { fError = error; };
+	int32			GetError() { return fError; };
+	// how much of the source a PARTIAL output covers
+	void			SetPartialTime(bigtime_t time_us) { fPartialTime = time_us; };
+	// a RUNNING job whose ffmpeg is stopped for the time being
+	void			SetPaused(bool paused) { fPaused = paused; };
+	bool			IsPaused() { return fPaused; };
+	// encoding time a job continued from checkpoints didn't have to redo
+	void			SetRecoveredTime(bigtime_t time_us) { fRecoveredTime = time_us; };
+	void			AddToLog(const BString& log);
+
+	// set through JobList, which keeps the waiting jobs in order
+	int32			GetPriority() { return fPriority; };
+	time_t			GetDeadline() { return fDeadline; };
+	float			GetPredictedCost() { return fPredictedCost; };
 
 private:
+	friend class JobList;
+
 	BString			fFilename;
 	BString			fJobName;
 	BString			fDuration;
 	BString			fCommandLine;
 	BMessage		fJobMessage;
 	BString			fStatus;
-	BString			fLog;
+	LogStore		fLog;
 	int32			fJobNumber;
 	int32			fDurationSecs;
 	int32			fStatusID;
+	int32			fError;
+	bigtime_t		fPartialTime;
+	bool			fPaused;
+	bigtime_t		fRecoveredTime;
+	// the list the job is in, to count its status there
+	JobList*		fList;
+	int32			fSequence;
+	int32			fPriority;
+	time_t			fDeadline; // 0 means: none
+	float			fPredictedCost;
 };
 
 
@@ -7,7 +7,9 @@
 
 
 #include "JobWindow.h"
+#include "ErrorMatcher.h"
 #include "Messages.h"
+#include "Utilities.h"
 
 #include <Alert.h>
 #include <Catalog.h>
@@ -19,16 +21,41 @@
 #include <LayoutBuilder.h>
 #include <Menu.h>
 #include <MenuBar.h>
+#include <MessageRunner.h>
 #include <Notification.h>
+#include <OS.h>
 #include <Path.h>
 #include <Roster.h>
 #include <StringFormat.h>
 
+#include <algorithm>
 #include <stdio.h>
 
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "JobWindow"
 
+static const int32 kMaxConcurrency = 32;
+// Bytes of a job's log shown at a time
+static const off_t kLogPageSize = 16 * 1024;
+// At most that much of the changes to the queue is lost in a crash
+static const bigtime_t kJournalSyncInterval = 1000000;
+
+
+static BString
+video_codec(const char* commandline)
+{
+	BString command(commandline);
+	int32 start = command.FindFirst("-vcodec ");
+	if (start < 0)
+		return BString();
+
+	start += strlen("-vcodec ");
+	int32 end = command.FindFirst(" ", start);
+	BString codec;
+	command.CopyInto(codec, start, ((end < 0) ? command.Length() : end) - start);
+	return codec;
+}
+
 
 // Context menu
 ContextMenu::ContextMenu(const char* name, BMessenger target)
@@ -50,12 +77,22 @@ JobWindow::JobWindow(BRect frame, BMessage* settings, BMessenger* target)
 	:
 	BWindow(frame, B_TRANSLATE("Job manager"), B_TITLED_WINDOW,
 		B_NOT_ZOOMABLE | B_AUTO_UPDATE_SIZE_LIMITS),
-	fJobRunning(false),
-	fSingleJob(WAITING),
 	fJobNumber(1),
 	fMainWindow(target),
-	fShowingPopUpMenu(false)
+	fShowingPopUpMenu(false),
+	fRunningCount(0),
+	fFinishedCount(0),
+	fConcurrency(0),
+	fQueueRunning(false),
+	fResumable(false),
+	fJournalRunner(NULL)
 {
+	LogStore::RemoveStaleFiles();
+
+	system_info info;
+	get_system_info(&info);
+	fCPUCount = std::max((int32)info.cpu_count, (int32)1);
+
 	// menu bar
 	BMenuBar* menuBar = new BMenuBar("menubar");
 	BMenu* menu;
@@ -69,10 +106,47 @@ JobWindow::JobWindow(BRect frame, BMessage* settings, BMessenger* target)
 	fStartAbortMenu = new BMenuItem(
 		B_TRANSLATE("Start all jobs"), new BMessage(M_JOB_START), 'S');
 	menu->AddItem(fStartAbortMenu);
+	fPauseMenu = new BMenuItem(
+		B_TRANSLATE("Pause all jobs"), new BMessage(M_JOB_PAUSE));
+	menu->AddItem(fPauseMenu);
 	fClearMenu = new BMenuItem(
 		B_TRANSLATE("Clear finished"), new BMessage(M_CLEAR_LIST), 'F');
 	menu->AddItem(fClearMenu);
 	menu->AddSeparatorItem();
+
+	fConcurrencyMenu = new BMenu(B_TRANSLATE("Parallel jobs"));
+	fConcurrencyMenu->SetRadioMode(true);
+	BMessage* concurrency = new BMessage(M_JOB_CONCURRENCY);
+	concurrency->AddInt32("concurrency", 0);
+	fConcurrencyMenu->AddItem(new BMenuItem(B_TRANSLATE("Automatic"), concurrency));
+	fConcurrencyMenu->AddSeparatorItem();
+	for (int32 i = 1; i <= std::min(fCPUCount, kMaxConcurrency); i++) {
+		BString label;
+		label << i;
+		concurrency = new BMessage(M_JOB_CONCURRENCY);
+		concurrency->AddInt32("concurrency", i);
+		fConcurrencyMenu->AddItem(new BMenuItem(label, concurrency));
+	}
+	menu->AddItem(fConcurrencyMenu);
+
+	fPolicyMenu = new BMenu(B_TRANSLATE("Job order"));
+	fPolicyMenu->SetRadioMode(true);
+	const char* policies[] = {
+		B_TRANSLATE("As listed"),
+		B_TRANSLATE("By priority"),
+		B_TRANSLATE("Shortest first"),
+		B_TRANSLATE("By deadline")
+	};
+	for (int32 i = SCHEDULE_FIFO; i <= SCHEDULE_DEADLINE; i++) {
+		BMessage* policy = new BMessage(M_JOB_POLICY);
+		policy->AddInt32("policy", i);
+		fPolicyMenu->AddItem(new BMenuItem(policies[i], policy));
+	}
+	menu->AddItem(fPolicyMenu);
+	fResumableMenu = new BMenuItem(
+		B_TRANSLATE("Resumable encoding"), new BMessage(M_JOB_RESUMABLE));
+	menu->AddItem(fResumableMenu);
+	menu->AddSeparatorItem();
 	fRemoveAllMenu = new BMenuItem(
 		B_TRANSLATE("Remove all jobs"), new BMessage(M_JOB_REMOVE_ALL));
 	menu->AddItem(fRemoveAllMenu);
@@ -82,9 +156,16 @@ JobWindow::JobWindow(BRect frame, BMessage* settings, BMessenger* target)
 	fStartAbortSingleMenu = new BMenuItem(
 		B_TRANSLATE("Start job"), new BMessage(M_JOB_INVOKED), 'S', B_SHIFT_KEY);
 	menu->AddItem(fStartAbortSingleMenu);
+	fPauseSingleMenu = new BMenuItem(
+		B_TRANSLATE("Pause this job"), new BMessage(M_JOB_PAUSE));
+	menu->AddItem(fPauseSingleMenu);
 	fEditMenu = new BMenuItem(
 		B_TRANSLATE("Edit job"), new BMessage(M_JOB_EDIT), 'E');
 	menu->AddItem(fEditMenu);
+	fPriorityMenu = _PriorityMenu(PRIORITY_NORMAL);
+	menu->AddItem(fPriorityMenu);
+	fDeadlineMenu = _DeadlineMenu();
+	menu->AddItem(fDeadlineMenu);
 	fPlayMenu = new BMenuItem(
 		B_TRANSLATE("Play output file"), new BMessage(M_JOB_INVOKED), 'P');
 	menu->AddItem(fPlayMenu);
@@ -177,11 +258,13 @@ JobWindow::JobWindow(BRect frame, BMessage* settings, BMessenger* target)
 			.End()
 		.End();
 
-	// initialize job command launcher
-	fJobCommandLauncher = new CommandLauncher(new BMessenger(this));
-
+	// The queue is replayed from the journal, or taken from the file older
+	// versions saved on quit
+	bigtime_t restoreStart = system_time();
 	BMessage jobs;
-	_LoadJobs(jobs);
+	bool migrate = false;
+	if (fJournal.Replay(jobs) != B_OK)
+		migrate = _LoadJobs(jobs) == B_OK;
 
 	const char* filename;
 	const char* duration;
@@ -193,14 +276,48 @@ JobWindow::JobWindow(BRect frame, BMessage* settings, BMessenger* target)
 			&& (jobs.FindString("command", i, &command) == B_OK)
 			&& (jobs.FindMessage("jobmessage", i, &jobmessage) == B_OK)) {
 		AddJob(filename, duration, command, jobmessage);
+		JobRow* row = fJobList->FindCommandLine(command);
+		if (row != NULL) {
+			fJobList->SetPriority(row, jobs.GetInt32("priority", i, PRIORITY_NORMAL));
+			fJobList->SetDeadline(row, jobs.GetInt64("deadline", i, 0));
+		}
 		i++;
 	}
 
+	// A fresh journal with just the restored jobs, which are numbered anew
+	_CompactJournal();
+	if (migrate) {
+		BPath path;
+		if (find_directory(B_USER_SETTINGS_DIRECTORY, &path) == B_OK
+			&& path.Append("ffmpegGUI/jobs") == B_OK)
+			BEntry(path.Path()).Remove();
+	}
+
+	BMessage restored(M_JOBS_RESTORED);
+	restored.AddInt32("jobcount", i);
+	restored.AddInt32("records", jobs.GetInt32("records", 0));
+	restored.AddInt64("elapsed", system_time() - restoreStart);
+	fMainWindow->SendMessage(&restored);
+
+	BMessage sync(M_JOURNAL_SYNC);
+	fJournalRunner = new BMessageRunner(BMessenger(this), &sync, kJournalSyncInterval);
+
 	if (fJobList->CountRows() != 0)
 		fJobList->AddToSelection(fJobList->RowAt(0));
 
 	_UpdateStates();
 
+	int32 parallelJobs;
+	if (settings->FindInt32("job_concurrency", &parallelJobs) == B_OK)
+		_SetConcurrency(parallelJobs);
+	else
+		_SetConcurrency(0);
+
+	_SetPolicy(settings->GetInt32("job_policy", SCHEDULE_FIFO));
+
+	fResumable = settings->GetBool("job_resumable", false);
+	fResumableMenu->SetMarked(fResumable);
+
 	// apply window settings
 	if (settings->FindRect("job_window", &frame) == B_OK) {
 		MoveTo(frame.LeftTop());
@@ -219,15 +336,22 @@ JobWindow::JobWindow(BRect frame, BMessage* settings, BMessenger* target)
 
 JobWindow::~JobWindow()
 {
-	// clear finished or errored jobs before saving
+	delete fJournalRunner;
+
+	for (size_t i = 0; i < fJobEncoders.size(); i++) {
+		fJobEncoders[i]->Lock();
+		fJobEncoders[i]->Quit();
+	}
+
+	// errored jobs aren't replayed, their checkpoints won't be needed
 	for (int32 i = fJobList->CountRows() - 1; i >= 0; i--) {
 		JobRow* row = dynamic_cast<JobRow*>(fJobList->RowAt(i));
-		int32 status = row->GetStatus();
-		if ((status == ERROR) or (status == FINISHED))
-			fJobList->RemoveRow(row);
+		if (row->GetStatus() == ERROR)
+			_RemoveCheckpoint(row);
 	}
 
-	_SaveJobs();
+	// the journal is up to date already, it only needs to be on disk
+	fJournal.Sync();
 }
 
 
@@ -270,7 +394,8 @@ JobWindow::MessageReceived(BMessage* message)
 			BMessage jobArchive(row->GetJobMessage());
 			fMainWindow->SendMessage(&jobArchive);
 
-			fJobList->RemoveRow(row);
+			fJournal.RemoveJob(row->GetJobNumber());
+			fJobList->RemoveJob(row);
 			int32 count = fJobList->CountRows();
 			_SendJobCount(count);
 
@@ -295,7 +420,7 @@ JobWindow::MessageReceived(BMessage* message)
 				break;
 
 			int32 status = currentRow->GetStatus();
-			if (status == FINISHED) {
+			if ((status == FINISHED) or (status == PARTIAL)) {
 				_Open(currentRow->GetFilename());
 				break;
 			} else if (status == ERROR) {
@@ -304,56 +429,109 @@ JobWindow::MessageReceived(BMessage* message)
 			} else if (status == RUNNING)
 				break;
 
-			// Else we're WAITING: fall through and to a single job
-			fSingleJob = RUNNING;
-			// intentional fall through
+			// Else we're WAITING: start this single job
+			_StartJob(currentRow);
+			_UpdateTitle();
+			_UpdateStates();
+			break;
 		}
 		case M_JOB_START:
 		{
-			fCurrentJob = _GetNextJob();
-			if (fCurrentJob == NULL) {
-				SetTitle(B_TRANSLATE("Job manager"));
-				fJobRunning = false;
-				_UpdateStates();
+			fQueueRunning = true;
+			_DispatchJobs();
+			break;
+		}
+		case M_JOB_ABORT:
+		{
+			if (message->GetBool("selected", false)) {
+				_AbortJob(dynamic_cast<JobRow*>(fJobList->CurrentSelection()));
+				break;
+			}
 
-				int32 count = (fSingleJob == FINISHED)? 1 : fJobList->CountRows();
-				BString text;
-				static BStringFormat format(B_TRANSLATE("{0, plural,"
-					"one{Encoding job finished.}"
-					"other{Encoding jobs finished.}}"));
-				format.Format(text, count);
-				BNotification encodeFinished(B_INFORMATION_NOTIFICATION);
-				encodeFinished.SetGroup(B_TRANSLATE_SYSTEM_NAME("ffmpeg GUI"));
-				encodeFinished.SetTitle(B_TRANSLATE("Job manager"));
-				encodeFinished.SetContent(text);
-				encodeFinished.Send();
+			fQueueRunning = false;
+			fFinishedCount = 0;
+			for (size_t slot = 0; slot < fRunningJobs.size(); slot++)
+				_AbortJob(fRunningJobs[slot]);
 
+			SetTitle(B_TRANSLATE("Job manager"));
+			break;
+		}
+		case M_JOB_PAUSE:
+		case M_JOB_RESUME:
+		{
+			bool pause = message->what == M_JOB_PAUSE;
+			if (message->GetBool("selected", false)) {
+				_PauseJob(dynamic_cast<JobRow*>(fJobList->CurrentSelection()), pause);
+				_UpdateStates();
 				break;
 			}
 
-			fJobRunning = true;
-			fCurrentJob->SetStatus(RUNNING);
+			// Paused jobs keep their slots, so no other job is started
+			// while they wait
+			for (size_t slot = 0; slot < fRunningJobs.size(); slot++)
+				_PauseJob(fRunningJobs[slot], pause);
 			_UpdateStates();
-
-			BMessage startMsg(M_ENCODE_COMMAND);
-			startMsg.AddString("cmdline", fCurrentJob->GetCommandLine());
-			fJobCommandLauncher->PostMessage(&startMsg);
 			break;
 		}
-		case M_JOB_ABORT:
+		case M_JOURNAL_SYNC:
+		{
+			// Changes go to disk in batches, and the journal is rewritten
+			// once it's mostly outdated
+			if (fJournal.NeedsCompaction(fJobList->CountRows()))
+				_CompactJournal();
+			else
+				fJournal.Sync();
+			break;
+		}
+		case M_JOB_POLICY:
+		{
+			int32 policy;
+			if (message->FindInt32("policy", &policy) == B_OK) {
+				_SetPolicy(policy);
+				_DispatchJobs();
+			}
+			break;
+		}
+		case M_JOB_RESUMABLE:
 		{
-			BMessage stop_encode_message(M_STOP_COMMAND);
-			fJobCommandLauncher->PostMessage(&stop_encode_message);
+			// only applies to jobs started from now on
+			fResumable = !fResumable;
+			fResumableMenu->SetMarked(fResumable);
+			break;
+		}
+		case M_JOB_PRIORITY:
+		case M_JOB_DEADLINE:
+		{
+			JobRow* row = dynamic_cast<JobRow*>(fJobList->CurrentSelection());
+			if (row == NULL)
+				break;
 
-			fJobRunning = false;
-			SetTitle(B_TRANSLATE("Job manager"));
+			if (message->what == M_JOB_PRIORITY)
+				fJobList->SetPriority(row, message->GetInt32("priority", PRIORITY_NORMAL));
+			else {
+				int32 seconds = message->GetInt32("seconds", 0);
+				fJobList->SetDeadline(row, (seconds > 0) ? real_time_clock() + seconds : 0);
+			}
+			fJournal.SetSchedule(row->GetJobNumber(), row->GetPriority(), row->GetDeadline());
+			_UpdateStates();
+			break;
+		}
+		case M_JOB_CONCURRENCY:
+		{
+			int32 concurrency;
+			if (message->FindInt32("concurrency", &concurrency) == B_OK) {
+				_SetConcurrency(concurrency);
+				_DispatchJobs();
+			}
 			break;
 		}
 		case M_JOB_REMOVE:
 		{
-			BRow* row = fJobList->CurrentSelection();
+			JobRow* row = dynamic_cast<JobRow*>(fJobList->CurrentSelection());
 			int32 rowIndex = fJobList->IndexOf(row);
-			fJobList->RemoveRow(row);
+			_RemoveCheckpoint(row);
+			fJournal.RemoveJob(row->GetJobNumber());
+			fJobList->RemoveJob(row);
 
 			int32 count = fJobList->CountRows();
 			_SendJobCount(count);
@@ -380,7 +558,10 @@ JobWindow::MessageReceived(BMessage* message)
 					break;
 				case 1:
 				{
-					fJobList->Clear();
+					for (int32 i = 0; i < fJobList->CountRows(); i++)
+						_RemoveCheckpoint(dynamic_cast<JobRow*>(fJobList->RowAt(i)));
+					fJobList->ClearJobs();
+					fJournal.Clear();
 					fJobNumber = 1;
 					_SendJobCount(0);
 					break;
@@ -426,15 +607,18 @@ JobWindow::MessageReceived(BMessage* message)
 			for (int32 i = fJobList->CountRows() - 1; i >= 0; i--) {
 				JobRow* row = dynamic_cast<JobRow*>(fJobList->RowAt(i));
 				int32 status = row->GetStatus();
-				if (status == FINISHED)
-					fJobList->RemoveRow(row);
+				if ((status == FINISHED) or (status == PARTIAL)) {
+					if (row == selectedRow)
+						selectedRow = NULL;
+					fJournal.RemoveJob(row->GetJobNumber());
+					fJobList->RemoveJob(row);
+				}
 			}
 
 			int32 count = fJobList->CountRows();
-			int32 index = fJobList->IndexOf(selectedRow);
-			if (count = 0)
+			if (count == 0)
 				fJobNumber = 1;
-			else if (index >= 0) // formerly selected row is still with us?
+			else if (selectedRow != NULL) // formerly selected row is still with us?
 				fJobList->AddToSelection(selectedRow);
 			else if (count != 0)
 				fJobList->AddToSelection(fJobList->RowAt(0));
@@ -450,7 +634,9 @@ JobWindow::MessageReceived(BMessage* message)
 			if (rowIndex < 1)
 				break;
 
-			fJobList->SwapRows(rowIndex, rowIndex - 1);
+			fJournal.SwapJobs(dynamic_cast<JobRow*>(row)->GetJobNumber(),
+				dynamic_cast<JobRow*>(fJobList->RowAt(rowIndex - 1))->GetJobNumber());
+			fJobList->SwapJobs(rowIndex, rowIndex - 1);
 			fJobList->AddToSelection(fJobList->RowAt(rowIndex - 1));
 			_UpdateStates();
 			break;
@@ -463,64 +649,118 @@ JobWindow::MessageReceived(BMessage* message)
 			if ((rowIndex == last) || (rowIndex < 0))
 				break;
 
-			fJobList->SwapRows(rowIndex, rowIndex + 1);
+			fJournal.SwapJobs(dynamic_cast<JobRow*>(row)->GetJobNumber(),
+				dynamic_cast<JobRow*>(fJobList->RowAt(rowIndex + 1))->GetJobNumber());
+			fJobList->SwapJobs(rowIndex, rowIndex + 1);
 			fJobList->AddToSelection(fJobList->RowAt(rowIndex + 1));
 			_UpdateStates();
 			break;
 		}
 		case M_ENCODE_PROGRESS:
 		{
+			int32 slot = message->GetInt32("id", -1);
+			if (slot < 0 || slot >= (int32)fRunningJobs.size() || fRunningJobs[slot] == NULL)
+				break;
+
+			JobRow* row = fRunningJobs[slot];
 			BString progress_data;
-			message->FindString("data", &progress_data);
-			fCurrentJob->AddToLog(progress_data);
+			if (message->FindString("data", &progress_data) == B_OK)
+				row->AddToLog(progress_data);
 
-			int32 seconds;
-			message->FindInt32("time", &seconds);
+			bigtime_t time_us;
+			if (message->FindInt64("time_us", &time_us) != B_OK)
+				time_us = -1;
 
 			// calculate progress percentage
-			if (seconds > -1) {
-				int32 duration = fCurrentJob->GetDurationSeconds();
+			if (time_us > -1) {
+				int32 duration = row->GetDurationSeconds();
 				int32 encode_percentage;
 
 				if (duration > 0)
-					encode_percentage = (seconds * 100) / duration;
+					encode_percentage = std::min((bigtime_t)100, time_us / ((bigtime_t)duration * 10000));
 				else
 					encode_percentage = 0;
 
-				BString title(B_TRANSLATE("Job"));
-				if (fSingleJob == RUNNING)
-					title << " " << fCurrentJob->GetJobNumber() << ": ";
-				else
-					title << " (" << _CountFinished() << "/" << fJobList->CountRows() << "): ";
-				title << encode_percentage << "%";
-				SetTitle(title);
+				if (row->IsPaused())
+					break;
 
-				title = B_TRANSLATE("Running:");
-				title << " " << encode_percentage << "%";
-				fCurrentJob->SetStatus(title);
+				// the time left is estimated from the time the job was
+				// actually running
+				BString status(B_TRANSLATE("Running:"));
+				status << " " << encode_percentage << "%";
+				bigtime_t active_us;
+				if (duration > 0 && time_us > 0
+					&& message->FindInt64("active_us", &active_us) == B_OK) {
+					double remaining = (double)active_us
+						* ((double)duration * 1000000 - time_us) / time_us;
+					if (remaining > 0) {
+						char timeText[16];
+						seconds_to_string(remaining / 1000000, timeText, sizeof(timeText));
+						BString left_string(B_TRANSLATE("%time% left"));
+						left_string.ReplaceFirst("%time%", timeText);
+						status << ", " << left_string;
+					}
+				}
+
+				// encoding time saved by continuing from checkpoints
+				bigtime_t recovered_us;
+				if (message->FindInt64("recovered_us", &recovered_us) == B_OK) {
+					row->SetRecoveredTime(recovered_us);
+					char timeText[16];
+					seconds_to_string(recovered_us / 1000000, timeText, sizeof(timeText));
+					BString recovered_string(B_TRANSLATE("%time% recovered"));
+					recovered_string.ReplaceFirst("%time%", timeText);
+					status << " (" << recovered_string << ")";
+				}
+				row->SetStatus(status);
 			}
 			break;
 		}
 		case M_ENCODE_FINISHED:
 		{
+			int32 slot = message->GetInt32("id", -1);
+			if (slot < 0 || slot >= (int32)fRunningJobs.size() || fRunningJobs[slot] == NULL)
+				break;
+
+			JobRow* row = fRunningJobs[slot];
+			fRunningJobs[slot] = NULL;
+			fRunningCount--;
+			row->SetPaused(false);
+
 			status_t exit_code;
 			message->FindInt32("exitcode", &exit_code);
 
-			if (exit_code == ABORTED) {
-				fSingleJob = WAITING;
-				fCurrentJob->SetStatus(WAITING);
-				_UpdateStates();
-				break;
+			// the time from aborting to ffmpeg having quit
+			bigtime_t stop_latency;
+			if (message->FindInt64("stop_latency", &stop_latency) == B_OK) {
+				BString stop_string(B_TRANSLATE("\nAborted: ffmpeg quit after %time% ms\n"));
+				stop_string.ReplaceFirst("%time%", BString() << stop_latency / 1000);
+				row->AddToLog(stop_string);
 			}
-			if (exit_code == SUCCESS)
-				fCurrentJob->SetStatus(FINISHED);
-			else
-				fCurrentJob->SetStatus(ERROR);
 
-			if (fSingleJob == RUNNING)
-				fSingleJob = FINISHED; // means single job finished
+			row->SetError(message->GetInt32("error", ERROR_NONE));
+			row->SetRecoveredTime(message->GetInt64("recovered_us", 0));
+			if (exit_code == ABORTED)
+				row->SetStatus(WAITING);
+			else if (exit_code == STOPPED) {
+				// Only aborting stops a job, so it isn't announced as
+				// finished
+				row->SetPartialTime(message->GetInt64("time_us", 0));
+				row->SetStatus(PARTIAL);
+			} else {
+				row->SetStatus((exit_code == SUCCESS) ? FINISHED : ERROR);
+				fFinishedCount++;
+			}
+			fJournal.SetStatus(row->GetJobNumber(), row->GetStatus(),
+				message->GetInt64("elapsed", -1));
+
+			if (fQueueRunning)
+				_DispatchJobs();
+			else if ((fRunningCount == 0) && (fFinishedCount > 0))
+				_NotifyFinished();
 
-			BMessenger(this).SendMessage(M_JOB_START);
+			_UpdateTitle();
+			_UpdateStates();
 			break;
 		}
 
@@ -551,18 +791,36 @@ JobWindow::_ShowPopUpMenu(BPoint where)
 	if (status == RUNNING) {
 		label = B_TRANSLATE("Abort this job");
 		message = new BMessage(M_JOB_ABORT);
+		message->AddBool("selected", true);
 	}
 	item = new BMenuItem(label, message, 'S', B_SHIFT_KEY);
 	menu->AddItem(item);
 	item->SetEnabled(((status == RUNNING) or (status == WAITING)) ? true : false);
 
+	message = new BMessage(currentRow->IsPaused() ? M_JOB_RESUME : M_JOB_PAUSE);
+	message->AddBool("selected", true);
+	item = new BMenuItem(currentRow->IsPaused()
+		? B_TRANSLATE("Resume this job") : B_TRANSLATE("Pause this job"), message);
+	menu->AddItem(item);
+	item->SetEnabled((status == RUNNING) ? true : false);
+
 	item = new BMenuItem(B_TRANSLATE("Edit this job"), new BMessage(M_JOB_EDIT), 'E');
 	menu->AddItem(item);
 	item->SetEnabled((status != RUNNING) ? true : false);
 
+	// only the order of waiting jobs can be changed
+	BMenu* submenu = _PriorityMenu(currentRow->GetPriority());
+	submenu->SetTargetForItems(this);
+	submenu->SetEnabled((status == WAITING) ? true : false);
+	menu->AddItem(submenu);
+	submenu = _DeadlineMenu();
+	submenu->SetTargetForItems(this);
+	submenu->SetEnabled((status == WAITING) ? true : false);
+	menu->AddItem(submenu);
+
 	item = new BMenuItem(B_TRANSLATE("Play output file"), new BMessage(M_JOB_INVOKED), 'P');
 	menu->AddItem(item);
-	item->SetEnabled((status == FINISHED) ? true : false);
+	item->SetEnabled(((status == FINISHED) or (status == PARTIAL)) ? true : false);
 
 	item = new BMenuItem(
 		B_TRANSLATE("Open output folder"), new BMessage(M_OPEN_FOLDER), 'O');
@@ -612,55 +870,27 @@ JobWindow::_LoadJobs(BMessage& jobs)
 }
 
 
-status_t
-JobWindow::_SaveJobs()
+void
+JobWindow::_CompactJournal()
 {
-	BPath path;
-	status_t status = find_directory(B_USER_SETTINGS_DIRECTORY, &path);
-	if (status != B_OK)
-		return status;
-
-	status = path.Append("ffmpegGUI");
-	if (status != B_OK)
-		return status;
-
-	status = create_directory(path.Path(), 0777);
-	if (status != B_OK)
-		return status;
-
-	status = path.Append("jobs");
-	if (status != B_OK)
-		return status;
-
-	// remove "jobs" file if there are none.
-	if (fJobList->CountRows() == 0) {
-		BEntry entry(path.Path());
-		status = entry.Remove();
-		return status;
-	}
-
-	BFile file;
-	status = file.SetTo(path.Path(), B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
-	if (status != B_OK)
-		return status;
-
-	BMessage jobs('jobs');
-
+	// Done jobs wouldn't be replayed, so they're left out right away
+	BMessage jobs;
 	for (int32 i = 0; i < fJobList->CountRows(); i++) {
 		JobRow* row = dynamic_cast<JobRow*>(fJobList->RowAt(i));
 		int32 state = row->GetStatus();
-		if (state != FINISHED) {
+		if ((state == WAITING) or (state == RUNNING)) {
+			jobs.AddInt32("id", row->GetJobNumber());
 			jobs.AddString("filename", row->GetFilename());
 			jobs.AddString("duration", row->GetDuration());
 			jobs.AddString("command", row->GetCommandLine());
-			jobs.AddMessage("jobmessage", new BMessage(row->GetJobMessage()));
+			BMessage jobmessage(row->GetJobMessage());
+			jobs.AddMessage("jobmessage", &jobmessage);
+			jobs.AddInt32("priority", row->GetPriority());
+			jobs.AddInt64("deadline", row->GetDeadline());
 		}
 	}
 
-	if (status == B_OK)
-		status = jobs.Flatten(&file);
-
-	return status;
+	fJournal.Compact(jobs);
 }
 
 
@@ -676,11 +906,84 @@ JobWindow::_Open(const char* filepath)
 void
 JobWindow::_ShowLog(JobRow* row)
 {
-	BString text;
-	text << row->GetJobName() << ":\n\n" << row->GetLog();
-	BAlert* alert = new BAlert("log", text, B_TRANSLATE("OK"));
-	alert->SetShortcut(0, B_ESCAPE);
-	alert->Go();
+	// The log is shown page by page, starting with its end. Only the page
+	// shown is read from the log.
+	const LogStore& log = row->GetLog();
+	off_t size = log.Size();
+	off_t end = size;
+	off_t start = _PageStart(log, end);
+
+	char* buffer = new char[kLogPageSize];
+	while (true) {
+		ssize_t length = log.ReadAt(start, buffer, end - start);
+		if (length < 0)
+			length = 0;
+
+		BString text;
+		text << row->GetJobName() << ":\n";
+		if (size > kLogPageSize) {
+			BString range(B_TRANSLATE("(Bytes %start% - %end% of %size%)"));
+			range.ReplaceFirst("%start%", BString() << start);
+			range.ReplaceFirst("%end%", BString() << end);
+			range.ReplaceFirst("%size%", BString() << size);
+			text << range << "\n";
+		}
+		text << "\n";
+		text.Append(buffer, length);
+
+		BAlert* alert = new BAlert("log", text, B_TRANSLATE("Older"),
+			B_TRANSLATE("Newer"), B_TRANSLATE("OK"));
+		alert->SetShortcut(2, B_ESCAPE);
+		alert->ButtonAt(0)->SetEnabled(start > 0);
+		alert->ButtonAt(1)->SetEnabled(end < size);
+
+		int32 choice = alert->Go();
+		if (choice == 0) {
+			end = start;
+			start = _PageStart(log, end);
+		} else if (choice == 1) {
+			start = end;
+			end = _PageEnd(log, start);
+		} else
+			break;
+	}
+	delete[] buffer;
+}
+
+
+off_t
+JobWindow::_PageStart(const LogStore& log, off_t end)
+{
+	// Pages start at the beginning of a line, if there is one in the page
+	off_t start = std::max((off_t)0, end - kLogPageSize);
+	if (start == 0)
+		return start;
+
+	char buffer[kLogPageSize];
+	ssize_t length = log.ReadAt(start, buffer, end - start);
+	for (ssize_t i = 0; i < length - 1; i++) {
+		if (buffer[i] == '\n')
+			return start + i + 1;
+	}
+	return start;
+}
+
+
+off_t
+JobWindow::_PageEnd(const LogStore& log, off_t start)
+{
+	// Pages end after the last full line, if there is one in the page
+	off_t end = std::min(log.Size(), start + kLogPageSize);
+	if (end == log.Size())
+		return end;
+
+	char buffer[kLogPageSize];
+	ssize_t length = log.ReadAt(start, buffer, end - start);
+	for (ssize_t i = length - 1; i > 0; i--) {
+		if (buffer[i] == '\n')
+			return start + i + 1;
+	}
+	return end;
 }
 
 
@@ -688,14 +991,16 @@ void
 JobWindow::AddJob(const char* filename, const char* duration, const char* commandline,
 				BMessage jobmessage, int32 statusID)
 {
-	if (!_IsUniqueJob(commandline))
+	if (fJobList->FindCommandLine(commandline) != NULL)
 		return;
 
-	int32 index = _IndexOfSameFilename(filename);
-	if (index == -1) {
+	JobRow* sameFile = fJobList->FindFilename(filename);
+	if (sameFile == NULL) {
 		JobRow* row = new JobRow(
 			fJobNumber++, filename, duration, commandline, jobmessage, WAITING);
-		fJobList->AddRow(row);
+		fJobList->AddJob(row);
+		fJobList->SetPredictedCost(row, _PredictCost(row));
+		fJournal.AddJob(row->GetJobNumber(), filename, duration, commandline, jobmessage);
 
 		BRow* selected = fJobList->CurrentSelection();
 		if (selected == NULL)
@@ -720,7 +1025,7 @@ JobWindow::AddJob(const char* filename, const char* duration, const char* comman
 			return;
 		case 1:
 		{
-			fJobList->AddToSelection(fJobList->RowAt(index));
+			fJobList->AddToSelection(sameFile);
 			if (IsHidden())
 				Show();
 		}
@@ -731,7 +1036,7 @@ JobWindow::AddJob(const char* filename, const char* duration, const char* comman
 bool
 JobWindow::IsJobRunning()
 {
-	return fJobRunning;
+	return fRunningCount > 0;
 }
 
 
@@ -766,62 +1071,329 @@ JobWindow::_SendJobCount(int32 count)
 int32
 JobWindow::_CountFinished()
 {
-	int32 count = 1;
+	return fJobList->CountJobs(FINISHED) + fJobList->CountJobs(PARTIAL);
+}
 
-	for (int32 i = 0; i < fJobList->CountRows(); i++) {
-		JobRow* row = dynamic_cast<JobRow*>(fJobList->RowAt(i));
-		int32 status = row->GetStatus();
-		if (status == FINISHED)
-			count++;
-	}
-	return count;
+
+JobRow*
+JobWindow::_GetNextJob()
+{
+	return fJobList->NextWaitingJob();
 }
 
-bool
-JobWindow::_IsUniqueJob(const char* commandline)
+
+void
+JobWindow::_DispatchJobs()
 {
-	for (int32 i = 0; i < fJobList->CountRows(); i++) {
-		JobRow* row = dynamic_cast<JobRow*>(fJobList->RowAt(i));
-		BString command = row->GetCommandLine();
-		if (command == commandline)
-			return false;
+	// Keep starting waiting jobs until all slots are busy
+	while (fQueueRunning) {
+		JobRow* row = _GetNextJob();
+		if (row == NULL)
+			break;
+
+		if (fRunningCount > 0) {
+			if ((fConcurrency > 0) && (fRunningCount >= fConcurrency))
+				break;
+
+			// Automatic: only start another job if there are enough idle cores
+			if (fConcurrency == 0) {
+				int32 threads = _EstimateThreads(row);
+				for (size_t slot = 0; slot < fRunningJobs.size(); slot++) {
+					if (fRunningJobs[slot] != NULL)
+						threads += _EstimateThreads(fRunningJobs[slot]);
+				}
+				if (threads > fCPUCount)
+					break;
+			}
+		}
+		_StartJob(row);
 	}
-	return true;
+
+	if (fQueueRunning && (fRunningCount == 0)) {
+		fQueueRunning = false;
+		_NotifyFinished();
+	}
+
+	_UpdateTitle();
+	_UpdateStates();
+}
+
+
+void
+JobWindow::_StartJob(JobRow* row)
+{
+	int32 slot = _FreeSlot();
+	fRunningJobs[slot] = row;
+	if (fRunningCount++ == 0)
+		fFinishedCount = 0;
+
+	row->SetStatus(RUNNING);
+	row->SetRecoveredTime(0);
+	fJournal.SetStatus(row->GetJobNumber(), RUNNING);
+
+	// If asked for, long jobs are encoded in segments that survive
+	// aborting or quitting, the next start continues with the first
+	// unfinished one
+	BMessage startMsg(M_ENCODE_COMMAND);
+	startMsg.AddString("cmdline", row->GetCommandLine());
+	startMsg.AddBool("shell", row->GetJobMessage().GetBool("shell", false));
+	startMsg.AddInt32("duration", row->GetDurationSeconds());
+	BString checkpoint(_CheckpointPath(row));
+	if (fResumable && !checkpoint.IsEmpty())
+		startMsg.AddString("checkpoint", checkpoint);
+	startMsg.AddInt32("id", slot);
+	fJobEncoders[slot]->PostMessage(&startMsg);
+}
+
+
+void
+JobWindow::_AbortJob(JobRow* row)
+{
+	int32 slot = _SlotOfJob(row);
+	if (slot < 0)
+		return;
+
+	// the launcher continues a paused ffmpeg, so it can quit
+	row->SetPaused(false);
+
+	// Aborting again while ffmpeg still finishes the output kills it
+	BMessage stop_encode_message(M_STOP_COMMAND);
+	stop_encode_message.AddBool("graceful", true);
+	fJobEncoders[slot]->PostMessage(&stop_encode_message);
+}
+
+
+void
+JobWindow::_PauseJob(JobRow* row, bool pause)
+{
+	int32 slot = _SlotOfJob(row);
+	if (slot < 0 || row->IsPaused() == pause)
+		return;
+
+	fJobEncoders[slot]->PostMessage(pause ? M_PAUSE_COMMAND : M_RESUME_COMMAND);
+	row->SetPaused(pause);
+	if (pause)
+		row->SetStatus(B_TRANSLATE("Paused"));
 }
 
 
 int32
-JobWindow::_IndexOfSameFilename(const char* filename)
+JobWindow::_SlotOfJob(JobRow* row)
 {
-	for (int32 i = 0; i < fJobList->CountRows(); i++) {
-		JobRow* row = dynamic_cast<JobRow*>(fJobList->RowAt(i));
-		BString name = row->GetFilename();
-		if (name == filename)
-			return i;
+	if (row == NULL)
+		return -1;
+
+	for (size_t slot = 0; slot < fRunningJobs.size(); slot++) {
+		if (fRunningJobs[slot] == row)
+			return slot;
 	}
 	return -1;
 }
 
 
-JobRow*
-JobWindow::_GetNextJob()
+BString
+JobWindow::_CheckpointPath(JobRow* row)
 {
-	if (fSingleJob == RUNNING) {
-		JobRow* currentRow = dynamic_cast<JobRow*>(fJobList->CurrentSelection());
-		return currentRow;
+	// Named after the commandline, so a job that was changed starts over
+	BPath path;
+	if (find_directory(B_USER_CACHE_DIRECTORY, &path) != B_OK
+		|| path.Append("ffmpegGUI/checkpoints") != B_OK
+		|| create_directory(path.Path(), 0777) != B_OK)
+		return BString();
+
+	// FNV-1a
+	uint64 hash = 14695981039346656037ULL;
+	for (const char* c = row->GetCommandLine(); *c != '\0'; c++) {
+		hash ^= (uint8)*c;
+		hash *= 1099511628211ULL;
 	}
 
-	// single job finished
-	if (fSingleJob == FINISHED)
-		return NULL;
+	BString name;
+	name.SetToFormat("%016" B_PRIx64, hash);
+	path.Append(name);
+	return path.Path();
+}
 
-	for (int32 i = 0; i < fJobList->CountRows(); i++) {
-		JobRow* row = dynamic_cast<JobRow*>(fJobList->RowAt(i));
-		int32 status = row->GetStatus();
-		if (status == WAITING)
-			return row;
+
+void
+JobWindow::_RemoveCheckpoint(JobRow* row)
+{
+	BString checkpoint(_CheckpointPath(row));
+	if (!checkpoint.IsEmpty())
+		SegmentEncoder::RemoveCheckpoint(checkpoint);
+}
+
+
+int32
+JobWindow::_FreeSlot()
+{
+	for (size_t slot = 0; slot < fRunningJobs.size(); slot++) {
+		if (fRunningJobs[slot] == NULL)
+			return slot;
+	}
+
+	// all encoders are busy, add another one to the pool
+	fJobEncoders.push_back(new SegmentEncoder(new BMessenger(this)));
+	fRunningJobs.push_back(NULL);
+	return fRunningJobs.size() - 1;
+}
+
+
+int32
+JobWindow::_EstimateThreads(JobRow* row)
+{
+	// Most of our video encoders are single-threaded, so we can run one job
+	// per core. The ones that can use slice/frame threads get a few cores.
+	static const char* kThreadedCodecs[] = { "mpeg4", "vp8", "vp9", NULL };
+	static const int32 kThreadsPerThreadedJob = 4;
+
+	BString codec(video_codec(row->GetCommandLine()));
+	for (int32 i = 0; kThreadedCodecs[i] != NULL; i++) {
+		if (codec == kThreadedCodecs[i])
+			return std::min(kThreadsPerThreadedJob, fCPUCount);
+	}
+	return 1;
+}
+
+
+float
+JobWindow::_PredictCost(JobRow* row)
+{
+	// Rough encoding time per second of video, compared to mpeg4. Codecs
+	// that aren't known are guessed to be fairly slow.
+	static const struct {
+		const char*	codec;
+		float		cost;
+	} kCodecCosts[] = {
+		{ "copy", 0.05f },
+		{ "mjpeg", 0.5f },
+		{ "mpeg4", 1.0f },
+		{ "wmv1", 1.0f },
+		{ "wmv2", 1.0f },
+		{ "theora", 2.0f },
+		{ "vp8", 3.0f },
+		{ "vp9", 8.0f }
+	};
+	static const float kUnknownCost = 4.0f;
+
+	BString codec(video_codec(row->GetCommandLine()));
+	float cost = kUnknownCost;
+	for (size_t i = 0; i < B_COUNT_OF(kCodecCosts); i++) {
+		if (codec == kCodecCosts[i].codec) {
+			cost = kCodecCosts[i].cost;
+			break;
+		}
+	}
+	return std::max((int32)1, row->GetDurationSeconds()) * cost;
+}
+
+
+BMenu*
+JobWindow::_PriorityMenu(int32 priority)
+{
+	BMenu* menu = new BMenu(B_TRANSLATE("Priority"));
+	menu->SetRadioMode(true);
+	const char* labels[] = {
+		B_TRANSLATE("Low"),
+		B_TRANSLATE("Normal"),
+		B_TRANSLATE("High")
+	};
+	for (int32 i = PRIORITY_LOW; i <= PRIORITY_HIGH; i++) {
+		BMessage* message = new BMessage(M_JOB_PRIORITY);
+		message->AddInt32("priority", i);
+		BMenuItem* item = new BMenuItem(labels[i - PRIORITY_LOW], message);
+		item->SetMarked(i == priority);
+		menu->AddItem(item);
+	}
+	return menu;
+}
+
+
+BMenu*
+JobWindow::_DeadlineMenu()
+{
+	BMenu* menu = new BMenu(B_TRANSLATE("Deadline"));
+	const char* labels[] = {
+		B_TRANSLATE("None"),
+		B_TRANSLATE("In one hour"),
+		B_TRANSLATE("In four hours"),
+		B_TRANSLATE("In a day")
+	};
+	const int32 seconds[] = { 0, 3600, 4 * 3600, 24 * 3600 };
+	for (int32 i = 0; i < 4; i++) {
+		BMessage* message = new BMessage(M_JOB_DEADLINE);
+		message->AddInt32("seconds", seconds[i]);
+		menu->AddItem(new BMenuItem(labels[i], message));
+		if (i == 0)
+			menu->AddSeparatorItem();
 	}
-	return NULL;
+	return menu;
+}
+
+
+void
+JobWindow::_SetPolicy(int32 policy)
+{
+	if (policy < SCHEDULE_FIFO || policy > SCHEDULE_DEADLINE)
+		policy = SCHEDULE_FIFO;
+
+	fJobList->SetPolicy(policy);
+	BMenuItem* item = fPolicyMenu->ItemAt(policy);
+	if (item != NULL)
+		item->SetMarked(true);
+}
+
+
+void
+JobWindow::_SetConcurrency(int32 concurrency)
+{
+	fConcurrency = std::max((int32)0, std::min(concurrency,
+		std::min(fCPUCount, kMaxConcurrency)));
+
+	// the "Automatic" item is followed by a separator
+	BMenuItem* item = fConcurrencyMenu->ItemAt((fConcurrency == 0) ? 0 : fConcurrency + 1);
+	if (item != NULL)
+		item->SetMarked(true);
+}
+
+
+void
+JobWindow::_NotifyFinished()
+{
+	if (fFinishedCount == 0)
+		return;
+
+	BString text;
+	static BStringFormat format(B_TRANSLATE("{0, plural,"
+		"one{Encoding job finished.}"
+		"other{Encoding jobs finished.}}"));
+	format.Format(text, fFinishedCount);
+	BNotification encodeFinished(B_INFORMATION_NOTIFICATION);
+	encodeFinished.SetGroup(B_TRANSLATE_SYSTEM_NAME("ffmpeg GUI"));
+	encodeFinished.SetTitle(B_TRANSLATE("Job manager"));
+	encodeFinished.SetContent(text);
+	encodeFinished.Send();
+
+	fFinishedCount = 0;
+}
+
+
+void
+JobWindow::_UpdateTitle()
+{
+	BString title(B_TRANSLATE("Job manager"));
+	if (fRunningCount == 0) {
+		SetTitle(title);
+		return;
+	}
+
+	BString running;
+	static BStringFormat format(B_TRANSLATE("{0, plural,"
+		"one{# job running}"
+		"other{# jobs running}}"));
+	format.Format(running, fRunningCount);
+	title << " (" << _CountFinished() << "/" << fJobList->CountRows() << ")  •  " << running;
+	SetTitle(title);
 }
 
 
@@ -829,13 +1401,16 @@ void
 JobWindow::_UpdateStates()
 {
 	int32 count = fJobList->CountRows();
-	_SetStartAbortLabel((fJobRunning == true) ? ABORT : START);
+	bool jobRunning = fRunningCount > 0;
+	_SetStartAbortLabel(jobRunning ? ABORT : START);
 
 	// Empty list
 	if (count == 0) {
 		// menus
 		fStartAbortMenu->SetEnabled(false);
 		fStartAbortSingleMenu->SetEnabled(false);
+		fPauseMenu->SetEnabled(false);
+		fPauseSingleMenu->SetEnabled(false);
 		fPlayMenu->SetEnabled(false);
 		fOpenFolder->SetEnabled(false);
 		fRemoveMenu->SetEnabled(false);
@@ -843,6 +1418,8 @@ JobWindow::_UpdateStates()
 		fLogMenu->SetEnabled(false);
 		fCopyCommand->SetEnabled(false);
 		fEditMenu->SetEnabled(false);
+		fPriorityMenu->SetEnabled(false);
+		fDeadlineMenu->SetEnabled(false);
 		fClearMenu->SetEnabled(false);
 		// buttons
 		fStartAbortButton->SetEnabled(false);
@@ -854,18 +1431,20 @@ JobWindow::_UpdateStates()
 		return;
 	}
 
-	// check status of each job, see if any are finished, waiting or running
-	bool finished = false;
-	bool waitOrRun = false;
-	for (int32 i = 0; i < count; i++) {
-		JobRow* row = dynamic_cast<JobRow*>(fJobList->RowAt(i));
-		int32 status = row->GetStatus();
-		if (status == FINISHED)
-			finished = true;
-		if ((status == WAITING) or (status == RUNNING))
-			waitOrRun = true;
+	// see if any jobs are finished, waiting or running
+	bool finished = _CountFinished() > 0;
+	bool waitOrRun
+		= (fJobList->CountJobs(WAITING) + fJobList->CountJobs(RUNNING)) > 0;
+	bool paused = jobRunning;
+	for (size_t slot = 0; slot < fRunningJobs.size(); slot++) {
+		if (fRunningJobs[slot] != NULL && !fRunningJobs[slot]->IsPaused())
+			paused = false;
 	}
 	// menus
+	fPauseMenu->SetEnabled(jobRunning);
+	fPauseMenu->SetLabel(paused
+		? B_TRANSLATE("Resume all jobs") : B_TRANSLATE("Pause all jobs"));
+	fPauseMenu->SetMessage(new BMessage(paused ? M_JOB_RESUME : M_JOB_PAUSE));
 	fClearMenu->SetEnabled(finished);
 	fStartAbortMenu->SetEnabled(waitOrRun);
 	fStartAbortSingleMenu->SetEnabled(waitOrRun);
@@ -878,7 +1457,10 @@ JobWindow::_UpdateStates()
 	// Nothing selected
 	if (currentRow == NULL) {
 		// menus
+		fPauseSingleMenu->SetEnabled(false);
 		fEditMenu->SetEnabled(false);
+		fPriorityMenu->SetEnabled(false);
+		fDeadlineMenu->SetEnabled(false);
 		fPlayMenu->SetEnabled(false);
 		fRemoveMenu->SetEnabled(false);
 		fRemoveAllMenu->SetEnabled(false);
@@ -896,15 +1478,33 @@ JobWindow::_UpdateStates()
 	// menus
 	fLogMenu->SetEnabled((status == ERROR) ? true : false);
 	fRemoveMenu->SetEnabled((status == RUNNING) ? false : true);
-	fRemoveAllMenu->SetEnabled((fJobRunning) ? false : true);
+	fRemoveAllMenu->SetEnabled((jobRunning) ? false : true);
+	if (status == RUNNING) {
+		BMessage* abort = new BMessage(M_JOB_ABORT);
+		abort->AddBool("selected", true);
+		fStartAbortSingleMenu->SetLabel(B_TRANSLATE("Abort this job"));
+		fStartAbortSingleMenu->SetMessage(abort);
+	} else {
+		fStartAbortSingleMenu->SetLabel(B_TRANSLATE("Start this job"));
+		fStartAbortSingleMenu->SetMessage(new BMessage(M_JOB_INVOKED));
+	}
+	// disable the start/abort menu for the single selected job,
+	// if the job already ran (ended with error or successful)
 	fStartAbortSingleMenu->SetEnabled(
-		// disable the start/abort menu for the single selected job, if:
-		// a) the currently running job isn't a single job run, or
-		(((fJobRunning) and (fSingleJob == WAITING))
-		// b) the job already ran (enddd with error or successful
-		or ((status == ERROR) or (status == FINISHED))) ? false : true);
-	fPlayMenu->SetEnabled((status == FINISHED) ? true : false);
-	fEditMenu->SetEnabled(true);
+		((status == ERROR) or (status == FINISHED) or (status == PARTIAL)) ? false : true);
+	BMessage* pause = new BMessage(currentRow->IsPaused() ? M_JOB_RESUME : M_JOB_PAUSE);
+	pause->AddBool("selected", true);
+	fPauseSingleMenu->SetLabel(currentRow->IsPaused()
+		? B_TRANSLATE("Resume this job") : B_TRANSLATE("Pause this job"));
+	fPauseSingleMenu->SetMessage(pause);
+	fPauseSingleMenu->SetEnabled((status == RUNNING) ? true : false);
+	fPlayMenu->SetEnabled(((status == FINISHED) or (status == PARTIAL)) ? true : false);
+	fEditMenu->SetEnabled((status == RUNNING) ? false : true);
+	fPriorityMenu->SetEnabled((status == WAITING) ? true : false);
+	fDeadlineMenu->SetEnabled((status == WAITING) ? true : false);
+	BMenuItem* priority = fPriorityMenu->ItemAt(currentRow->GetPriority() - PRIORITY_LOW);
+	if (priority != NULL)
+		priority->SetMarked(true);
 	fCopyCommand->SetEnabled(true);
 	// buttons
 	fLogButton->SetEnabled((status == ERROR) ? true : false);
@@ -927,7 +1527,7 @@ JobWindow::_UpdateStates()
 void
 JobWindow::_SetStartAbortLabel(int32 state)
 {
-	int32 count = (fSingleJob == RUNNING)? 1 : fJobList->CountRows();
+	int32 count = fJobList->CountRows();
 	BString text;
 
 	if (state == START) {
@@ -937,9 +1537,6 @@ JobWindow::_SetStartAbortLabel(int32 state)
 		format.Format(text, count);
 		fStartAbortButton->SetMessage(new BMessage(M_JOB_START));
 		fStartAbortMenu->SetMessage(new BMessage(M_JOB_START));
-
-		fStartAbortSingleMenu->SetLabel(B_TRANSLATE("Start this job"));
-		fStartAbortSingleMenu->SetMessage(new BMessage(M_JOB_INVOKED));
 	} else {
 		static BStringFormat format(B_TRANSLATE("{0, plural,"
 			"one{Abort job}"
@@ -947,9 +1544,6 @@ JobWindow::_SetStartAbortLabel(int32 state)
 		format.Format(text, count);
 		fStartAbortButton->SetMessage(new BMessage(M_JOB_ABORT));
 		fStartAbortMenu->SetMessage(new BMessage(M_JOB_ABORT));
-
-		fStartAbortSingleMenu->SetLabel(B_TRANSLATE("Abort this job"));
-		fStartAbortSingleMenu->SetMessage(new BMessage(M_JOB_ABORT));
 	}
 	fStartAbortButton->SetLabel(text);
 	fStartAbortMenu->SetLabel(text);
@@ -12,7 +12,13 @@
 #include <Window.h>
 
 #include "CommandLauncher.h"
+#include "JobJournal.h"
 #include "JobList.h"
+#include "SegmentEncoder.h"
+
+#include <vector>
+
+class BMessageRunner;
 
 // Start/Abort button status
 enum {
@@ -42,6 +48,9 @@ public:
 			void	AddJob(const char* filename, const char* duration, const char* commandline,
 						BMessage jobmessage, int32 statusID = 0);
 			bool	IsJobRunning();
+			int32	Concurrency() { return fConcurrency; };
+			int32	Policy() { return fJobList->Policy(); };
+			bool	Resumable() { return fResumable; };
 
 	BMessage*		GetColumnState();
 			void	SetColumnState(BMessage* archive);
@@ -51,31 +60,62 @@ private:
 	bool			fShowingPopUpMenu;
 
 	status_t		_LoadJobs(BMessage& jobs);
-	status_t		_SaveJobs();
+	void			_CompactJournal();
 
 	void			_Open(const char* filepath);
 	void			_ShowLog(JobRow* row);
+	off_t			_PageStart(const LogStore& log, off_t end);
+	off_t			_PageEnd(const LogStore& log, off_t start);
 
 	void			_SendJobCount(int32);
 	int32			_CountFinished();
-	bool			_IsUniqueJob(const char* commandline);
-	int32			_IndexOfSameFilename(const char* filename);
 	JobRow*			_GetNextJob();
+	void			_DispatchJobs();
+	void			_StartJob(JobRow* row);
+	void			_AbortJob(JobRow* row);
+	void			_PauseJob(JobRow* row, bool pause);
+	int32			_SlotOfJob(JobRow* row);
+	BString			_CheckpointPath(JobRow* row);
+	void			_RemoveCheckpoint(JobRow* row);
+	int32			_FreeSlot();
+	int32			_EstimateThreads(JobRow* row);
+	void			_SetConcurrency(int32 concurrency);
+	void			_SetPolicy(int32 policy);
+	float			_PredictCost(JobRow* row);
+	BMenu*			_PriorityMenu(int32 priority);
+	BMenu*			_DeadlineMenu();
+	void			_NotifyFinished();
+	void			_UpdateTitle();
 	void			_UpdateStates();
 	void			_SetStartAbortLabel(int32 state);
 
 private:
-	CommandLauncher*	fJobCommandLauncher;
+	std::vector<SegmentEncoder*>	fJobEncoders;
+	std::vector<JobRow*>	fRunningJobs; // indexed by launcher slot
 	BMessenger*		fMainWindow;
 	JobList*		fJobList;
-	JobRow*			fCurrentJob;
 	int32			fJobNumber;
 
-	bool			fJobRunning;
-	int32			fSingleJob;
-
+	int32			fRunningCount;
+	int32			fFinishedCount;
+	int32			fCPUCount;
+	int32			fConcurrency; // 0 means: automatic
+	bool			fQueueRunning;
+	// long jobs are encoded in checkpointed segments
+	bool			fResumable;
+
+	JobJournal		fJournal;
+	BMessageRunner*	fJournalRunner;
+
+	BMenu*			fConcurrencyMenu;
+	BMenu*			fPolicyMenu;
+	BMenu*			fPriorityMenu;
+	BMenu*			fDeadlineMenu;
+	BMenuItem*		fResumableMenu;
 	BMenuItem*		fStartAbortMenu;
 	BMenuItem*		fStartAbortSingleMenu;
+	BMenuItem*		fPauseMenu;
+	BMenuItem*		fPauseSingleMenu;
 	BMenuItem*		fClearMenu;
 	BMenuItem*		fEditMenu;
 	BMenuItem*		fPlayMenu;
@@ -0,0 +1,248 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+
+
+#include "LogStore.h"
+
+#include <Directory.h>
+#include <Entry.h>
+#include <File.h>
+#include <FindDirectory.h>
+#include <OS.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdio.h>
+#include <unistd.h>
+
+
+// The ring buffer of a log is between these sizes
+static const size_t kMinRingSize = 4 * 1024;
+static const size_t kMaxRingSize = 64 * 1024;
+// All logs together never use more than this
+static const size_t kMemoryCap = 4 * 1024 * 1024;
+
+size_t LogStore::sMemoryUsed = 0;
+int32 LogStore::sFileCount = 0;
+
+
+LogStore::LogStore()
+	:
+	fRing(NULL),
+	fCapacity(0),
+	fStart(0),
+	fLength(0),
+	fSpilled(0)
+{
+}
+
+
+LogStore::~LogStore()
+{
+	Clear();
+}
+
+
+void
+LogStore::Append(const char* data, size_t length)
+{
+	if (length == 0)
+		return;
+
+	if (!_Grow(fLength + length)) {
+		if (fCapacity == 0) {
+			// no memory for a buffer at all
+			_Spill(data, length);
+			return;
+		}
+		if (length >= fCapacity) {
+			// Everything in the ring and the head of the new data goes to disk
+			_SpillOldest(fLength);
+			size_t head = length - fCapacity;
+			_Spill(data, head);
+			data += head;
+			length -= head;
+		} else {
+			// Spill at least half the ring, so we don't write to disk for
+			// every little piece of output
+			size_t needed = fLength + length - fCapacity;
+			_SpillOldest(std::min(fLength, std::max(needed, fCapacity / 2)));
+		}
+	}
+
+	// copy into the ring, possibly wrapping around its end
+	size_t end = (fStart + fLength) % fCapacity;
+	size_t first = std::min(length, fCapacity - end);
+	memcpy(fRing + end, data, first);
+	memcpy(fRing, data + first, length - first);
+	fLength += length;
+}
+
+
+void
+LogStore::Clear()
+{
+	free(fRing);
+	sMemoryUsed -= fCapacity;
+	fRing = NULL;
+	fCapacity = fStart = fLength = 0;
+
+	if (fSpillPath.InitCheck() == B_OK) {
+		BEntry(fSpillPath.Path()).Remove();
+		fSpillPath.Unset();
+	}
+	fSpilled = 0;
+}
+
+
+ssize_t
+LogStore::ReadAt(off_t offset, char* buffer, size_t size) const
+{
+	if (offset < 0 || offset >= Size())
+		return 0;
+
+	size_t done = 0;
+	if (offset < fSpilled) {
+		BFile file(fSpillPath.Path(), B_READ_ONLY);
+		ssize_t read = file.ReadAt(offset,
+			buffer, std::min((off_t)size, fSpilled - offset));
+		if (read < 0)
+			return read;
+		done = read;
+		offset += read;
+	}
+
+	if (done < size && offset >= fSpilled) {
+		size_t position = offset - fSpilled;
+		size_t count = std::min(size - done, fLength - position);
+		_CopyOut(position, buffer + done, count);
+		done += count;
+	}
+
+	return done;
+}
+
+
+void
+LogStore::RemoveStaleFiles()
+{
+	BPath path;
+	if (_Directory(path) != B_OK)
+		return;
+
+	BDirectory directory(path.Path());
+	BEntry entry;
+	while (directory.GetNextEntry(&entry) == B_OK) {
+		char name[B_FILE_NAME_LENGTH];
+		team_id team;
+		team_info info;
+		if (entry.GetName(name) == B_OK
+			&& sscanf(name, "%" B_SCNd32 "_", &team) == 1
+			&& get_team_info(team, &info) != B_OK)
+			entry.Remove();
+	}
+}
+
+
+bool
+LogStore::_Grow(size_t needed)
+{
+	if (needed <= fCapacity)
+		return true;
+	if (fCapacity >= kMaxRingSize)
+		return false;
+
+	size_t capacity = std::max(fCapacity, kMinRingSize);
+	while (capacity < needed && capacity < kMaxRingSize)
+		capacity *= 2;
+	capacity = std::min(capacity, kMaxRingSize);
+
+	// Every buffer counts against the cap, also the first one of a log. If
+	// there's no room, a smaller buffer has to do, or none at all.
+	size_t available = fCapacity + kMemoryCap - std::min(sMemoryUsed, kMemoryCap);
+	while (capacity > available && capacity > kMinRingSize)
+		capacity /= 2;
+	if (capacity > available || capacity <= fCapacity)
+		return false;
+
+	char* ring = (char*)malloc(capacity);
+	if (ring == NULL)
+		return false;
+
+	_CopyOut(0, ring, fLength);
+	free(fRing);
+	sMemoryUsed += capacity - fCapacity;
+	fRing = ring;
+	fCapacity = capacity;
+	fStart = 0;
+
+	return needed <= fCapacity;
+}
+
+
+void
+LogStore::_Spill(const char* data, size_t length)
+{
+	if (length == 0)
+		return;
+
+	if (fSpillPath.InitCheck() != B_OK) {
+		if (_Directory(fSpillPath) != B_OK)
+			return;
+		// named after our team, see RemoveStaleFiles()
+		BString name;
+		name.SetToFormat("%" B_PRId32 "_%" B_PRId32 ".log", (int32)getpid(),
+			atomic_add(&sFileCount, 1));
+		fSpillPath.Append(name);
+	}
+
+	// If the file can't be written, the output is lost, but the log keeps
+	// counting it so offsets stay consistent
+	BFile file(fSpillPath.Path(), B_WRITE_ONLY | B_CREATE_FILE | B_OPEN_AT_END);
+	file.Write(data, length);
+	fSpilled += length;
+}
+
+
+void
+LogStore::_SpillOldest(size_t length)
+{
+	// the oldest data may wrap around the end of the ring
+	size_t first = std::min(length, fCapacity - fStart);
+	_Spill(fRing + fStart, first);
+	_Spill(fRing, length - first);
+
+	fStart = (fStart + length) % std::max(fCapacity, (size_t)1);
+	fLength -= length;
+}
+
+
+void
+LogStore::_CopyOut(size_t position, char* buffer, size_t size) const
+{
+	if (size == 0)
+		return;
+
+	size_t start = (fStart + position) % fCapacity;
+	size_t first = std::min(size, fCapacity - start);
+	memcpy(buffer, fRing + start, first);
+	memcpy(buffer + first, fRing, size - first);
+}
+
+
+status_t
+LogStore::_Directory(BPath& path)
+{
+	status_t status = find_directory(B_USER_SETTINGS_DIRECTORY, &path);
+	if (status != B_OK)
+		return status;
+
+	status = path.Append("ffmpegGUI/logs");
+	if (status != B_OK)
+		return status;
+
+	return create_directory(path.Path(), 0777);
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+#ifndef LOGSTORE_H
+#define LOGSTORE_H
+
+
+#include <Path.h>
+#include <String.h>
+#include <SupportDefs.h>
+
+
+// The log of a job. Only the tail is kept in memory, in a ring buffer that
+// grows as long as the memory used by all logs together stays below a
+// global cap. Once that's reached, new logs go straight to disk. Older
+// output is appended to a spill file in the settings folder, which is
+// removed with the log.
+class LogStore {
+public:
+					LogStore();
+					~LogStore();
+
+	void			Append(const char* data, size_t length);
+	void			Clear();
+
+	off_t			Size() const { return fSpilled + fLength; }
+	ssize_t			ReadAt(off_t offset, char* buffer, size_t size) const;
+
+	// Spill files left behind by teams that no longer exist
+	static void		RemoveStaleFiles();
+
+private:
+					LogStore(const LogStore&);
+	LogStore&		operator=(const LogStore&);
+
+	bool			_Grow(size_t needed);
+	void			_Spill(const char* data, size_t length);
+	void			_SpillOldest(size_t length);
+	void			_CopyOut(size_t position, char* buffer, size_t size) const;
+
+	static status_t	_Directory(BPath& path);
+
+	char*			fRing;
+	size_t			fCapacity;
+	size_t			fStart;
+	size_t			fLength;
+
+	BPath			fSpillPath;
+	off_t			fSpilled;
+
+	static size_t	sMemoryUsed;
+	static int32	sFileCount;
+};
+
+
+#endif // LOGSTORE_H
@@ -13,14 +13,22 @@
 #include "App.h"
 #include "CropView.h"
 #include "CodecContainerOptions.h"
+#include "ChildPoller.h"
 #include "CommandLauncher.h"
+#include "CropDetector.h"
+#include "ErrorMatcher.h"
 #include "JobWindow.h"
 #include "Messages.h"
+#include "PreviewPool.h"
+#include "ProbeCache.h"
+#include "ProbePool.h"
+#include "SegmentEncoder.h"
 #include "Spinner.h"
 #include "Utilities.h"
 
 #include <Alert.h>
 #include <BeBuild.h>
+#include <Bitmap.h>
 #include <Box.h>
 #include <Button.h>
 #include <Catalog.h>
@@ -34,6 +42,7 @@
 #include <MenuBar.h>
 #include <MenuField.h>
 #include <MenuItem.h>
+#include <MessageRunner.h>
 #include <NodeInfo.h>
 #include <Notification.h>
 #include <Path.h>
@@ -52,6 +61,7 @@
 #include <TextView.h>
 #include <View.h>
 
+#include <algorithm>
 #include <cstdlib>
 #include <stdio.h>
 
@@ -67,15 +77,8 @@ static const char* kOutputExists = B_TRANSLATE_MARK(
 static const char* kOutputIsSource = B_TRANSLATE_MARK(
 	"Cannot overwrite the source file. Please choose another output file name.");
 
-// Use ffmpeg for 2ndary architecture (gcc11+) on 32bit Haiku
-// because vp8 and vp9 codecs are not available on gcc2 builds of ffmpeg_tools
-#ifdef B_HAIKU_32_BIT
-static const char* kFFMpeg = "ffmpeg-x86";
-static const char* kFFProbe = "ffprobe-x86";
-#else
-static const char* kFFMpeg = "ffmpeg";
-static const char* kFFProbe = "ffprobe";
-#endif
+// how long the source path has to stay unchanged before it's probed
+static const bigtime_t kSourceSettleDelay = 300000;
 
 // Tab order
 enum {
@@ -87,16 +90,16 @@ enum {
 MainWindow::MainWindow(BRect r, const char* name, window_type type, ulong mode)
 	:
 	BWindow(r, name, type, mode),
-	fStopAlert(NULL),
-	fLastRandomSecond(0)
+	fStopAlert(NULL)
 {
 	// Invoker for the Alerts to use to send their messages to the timer
 	fAlertInvoker.SetMessage(new BMessage(M_STOP_ALERT_BUTTON));
 	fAlertInvoker.SetTarget(this);
 
 	fEncodeStartTime = 0; // 0 means: no encoding in progress
+	fEncodePaused = false;
 
-	fSourceFilePanel = new BFilePanel(B_OPEN_PANEL, new BMessenger(this), NULL, B_FILE_NODE, false,
+	fSourceFilePanel = new BFilePanel(B_OPEN_PANEL, new BMessenger(this), NULL, B_FILE_NODE, true,
 		new BMessage(M_SOURCEFILE_REF));
 
 	fOutputFilePanel = new BFilePanel(B_SAVE_PANEL, new BMessenger(this), NULL, B_FILE_NODE, false,
@@ -181,8 +184,31 @@ MainWindow::MainWindow(BRect r, const char* name, window_type type, ulong mode)
 	fJobWindow->Show();
 	fJobWindow->Hide();
 
+	// media info of files probed before
+	fProbeCache = new ProbeCache();
+	fProbeCache->Load();
+	fProbePool = new ProbePool(new BMessenger(this), fProbeCache);
+	fBatchJobCount = 0;
+	fBatchSpawnCount = 0;
+	fBatchSpawnTime = 0;
+
 	// initialize command launcher
 	fCommandLauncher = new CommandLauncher(new BMessenger(this));
+	fInfoLauncher = new CommandLauncher(new BMessenger(this));
+	fProbeID = 0;
+	fSourceRunner = NULL;
+	fProbesAvoided = 0;
+	fPreviewPool = new PreviewPool(new BMessenger(this));
+	fCropDetector = new CropDetector(new BMessenger(this));
+	fSegmentEncoder = new SegmentEncoder(new BMessenger(this));
+	fEncoder = fCommandLauncher;
+
+	bool segmented = false;
+	if (settings.FindBool("segmented_encoding", &segmented) == B_OK)
+		fMenuSegmentedEncoding->SetMarked(segmented);
+	bool shell = false;
+	if (settings.FindBool("shell_commandline", &shell) == B_OK)
+		fMenuShellCommandline->SetMarked(shell);
 
 	// set the min and max values for the spin controls
 	fVideoBitrateSpinner->SetMinValue(64);
@@ -234,15 +260,21 @@ MainWindow::QuitRequested()
 			case 0:
 				return false;
 			case 1:
-				fJobWindow->PostMessage(M_JOB_ABORT);
+				// the jobs are killed below, with everything else
+				break;
 		}
 	}
 	_SaveSettings();
+	fProbeCache->Save();
 	_DeleteTempFiles();
 
 	fJobWindow->LockLooper();
 	fJobWindow->Quit();
 
+	// Nothing we started may outlive us. There's no time for a graceful
+	// stop, whatever still runs is killed right away.
+	ChildPoller::Default()->KillAll();
+
 	be_app->PostMessage(B_QUIT_REQUESTED);
 	return true;
 }
@@ -318,6 +350,31 @@ MainWindow::MessageReceived(BMessage* message)
 			SetTitle(title);
 			break;
 		}
+		case M_JOBS_RESTORED:
+		{
+			// how long replaying the job journal took at startup
+			int32 count = message->GetInt32("jobcount", 0);
+			if (count == 0)
+				break;
+
+			BString text(B_TRANSLATE(
+				"Restored %count% jobs from %records% journal records in %time% ms\n"));
+			text.ReplaceFirst("%count%", BString() << count);
+			text.ReplaceFirst("%records%", BString() << message->GetInt32("records", 0));
+			text.ReplaceFirst("%time%", BString() << message->GetInt64("elapsed", 0) / 1000);
+			fLogView->Insert(fLogView->TextLength(), text.String(), text.Length());
+			break;
+		}
+		case M_SEGMENTED_ENCODING:
+		{
+			fMenuSegmentedEncoding->SetMarked(!fMenuSegmentedEncoding->IsMarked());
+			break;
+		}
+		case M_SHELL_COMMANDLINE:
+		{
+			fMenuShellCommandline->SetMarked(!fMenuShellCommandline->IsMarked());
+			break;
+		}
 		case M_DEFAULTS:
 		{
 			_SetDefaults();
@@ -327,7 +384,43 @@ MainWindow::MessageReceived(BMessage* message)
 		}
 		case M_SOURCEFILE:
 		{
-			_GetMediaInfo();
+			// While a path is typed, it changes with every key. The source
+			// is only probed once it stayed the same for a moment.
+			if (fSourceRunner != NULL)
+				fProbesAvoided++;
+			delete fSourceRunner;
+			BMessage settled(M_SOURCEFILE_SETTLED);
+			fSourceRunner = new BMessageRunner(BMessenger(this), &settled,
+				kSourceSettleDelay, 1);
+
+			_ReadyToEncode();
+			break;
+		}
+		case M_SOURCEFILE_SETTLED:
+		{
+			delete fSourceRunner;
+			fSourceRunner = NULL;
+
+			// frames of an older path are of no use anymore
+			BMessage source_message(M_PREVIEW_SOURCE);
+			fPreviewPool->PostMessage(&source_message);
+
+			if (_FileExists(fSourceTextControl->Text())) {
+				if (fProbesAvoided > 0) {
+					BString avoided_string(
+						B_TRANSLATE("Media info: %count% probes avoided while typing\n"));
+					avoided_string.ReplaceFirst("%count%", BString() << fProbesAvoided);
+					fLogView->Insert(fLogView->TextLength(), avoided_string.String(),
+						avoided_string.Length());
+				}
+				_GetMediaInfo();
+			} else {
+				// Nothing to probe, and a probe of an older path still
+				// running or waiting is stopped
+				fProbesAvoided++;
+				fProbeID++;
+				fInfoLauncher->PostMessage(M_STOP_COMMAND);
+			}
 		} // intentional fall-though
 		case M_OUTPUTFILE:
 		{
@@ -419,6 +512,44 @@ MainWindow::MessageReceived(BMessage* message)
 
 			break;
 		}
+		case M_AUTO_CROP:
+		{
+			fAutoCropButton->SetEnabled(false);
+
+			BMessage detect(M_CROP_DETECT);
+			detect.AddString("path", fSourceTextControl->Text());
+			detect.AddInt32("duration", fEncodeDuration);
+			detect.AddInt32("width", atoi(fVideoWidth.String()));
+			detect.AddInt32("height", atoi(fVideoHeight.String()));
+			fCropDetector->PostMessage(&detect);
+			break;
+		}
+		case M_CROP_DETECTED:
+		{
+			int32 top, bottom, left, right;
+			if (message->FindInt32("top", &top) == B_OK
+				&& message->FindInt32("bottom", &bottom) == B_OK
+				&& message->FindInt32("left", &left) == B_OK
+				&& message->FindInt32("right", &right) == B_OK) {
+				fTopCrop->SetValue(top);
+				fBottomCrop->SetValue(bottom);
+				fLeftCrop->SetValue(left);
+				fRightCrop->SetValue(right);
+			}
+
+			BString time_string(B_TRANSLATE(
+				"Auto crop: %samples% samples in %time% ms"));
+			time_string.ReplaceFirst("%samples%",
+				BString() << message->GetInt32("samples", 0));
+			time_string.ReplaceFirst("%time%",
+				BString() << message->GetInt64("elapsed", 0) / 1000);
+			time_string << "\n";
+			fLogView->Insert(fLogView->TextLength(), time_string.String(),
+				time_string.Length());
+
+			fAutoCropButton->SetEnabled(fResetCroppingButton->IsEnabled());
+			break;
+		}
 		case M_VBITRATE:
 		case M_FRAMERATE:
 		case M_XRES:
@@ -469,6 +600,9 @@ MainWindow::MessageReceived(BMessage* message)
 		}
 		case M_SOURCEFILE_REF:
 		{
+			if (_AddBatchJobs(message))
+				break;
+
 			entry_ref ref;
 			message->FindRef("refs", &ref);
 			BEntry file_entry(&ref, true);
@@ -493,20 +627,43 @@ MainWindow::MessageReceived(BMessage* message)
 			_SetFileExtension();
 			break;
 		}
+		case M_BATCH_PROBED:
+		{
+			_AddBatchJob(message);
+			break;
+		}
 		case M_INFO_OUTPUT:
 		{
+			// output of a probe that was replaced by a newer one
+			if (message->GetInt32("id", -1) != fProbeID)
+				break;
+
 			BString info_data;
 			message->FindString("data", &info_data);
-			fMediainfo << info_data;
+			bigtime_t start = system_time();
+			fMediaInfoParser.Feed(info_data.String(), info_data.Length());
+			fMediaParseTime += system_time() - start;
 			break;
 		}
 		case M_INFO_FINISHED:
 		{
-			fEncodeDuration = 0;
-			_ParseMediaOutput();
-			_UpdateMediaInfo();
-			_AdoptDefaults();
-			_ExtractPreviewImage();
+			if (message->GetInt32("id", -1) != fProbeID)
+				break;
+
+			const MediaInfo& info = fMediaInfoParser.Info();
+			if (message->GetInt32("exitcode", FAILED) == SUCCESS && fMediaInfoParser.IsValid())
+				fProbeCache->Store(fProbedPath, info);
+
+			// time spent on getting the media info
+			BString time_string(
+				B_TRANSLATE("Media info: ffprobe took %probe% ms, parsing %parse% µs\n"));
+			time_string.ReplaceFirst("%probe%",
+				BString() << message->GetInt64("elapsed", 0) / 1000);
+			time_string.ReplaceFirst("%parse%", BString() << fMediaParseTime);
+			fLogView->Insert(fLogView->TextLength(), time_string.String(),
+				time_string.Length());
+
+			_MediaInfoReady(info);
 			break;
 		}
 		case M_ENCODE:
@@ -516,6 +673,9 @@ MainWindow::MessageReceived(BMessage* message)
 			fStartAbortButton->SetMessage(new BMessage(M_STOP_ENCODING));
 			fMenuStartEncode->SetEnabled(false);
 			fMenuStopEncode->SetEnabled(true);
+			fMenuPauseEncode->SetEnabled(true);
+			fMenuPauseEncode->SetLabel(B_TRANSLATE("Pause encoding"));
+			fEncodePaused = false;
 
 			fLogView->SelectAll();
 			fLogView->Clear();
@@ -535,9 +695,17 @@ MainWindow::MessageReceived(BMessage* message)
 
 			fStatusBar->SetText(files_string.String());
 
+			// Encode with several processes in parallel, if enabled
+			if (fMenuSegmentedEncoding->IsMarked())
+				fEncoder = fSegmentEncoder;
+			else
+				fEncoder = fCommandLauncher;
+
 			BMessage start_encode_message(M_ENCODE_COMMAND);
 			start_encode_message.AddString("cmdline", fCommand);
-			fCommandLauncher->PostMessage(&start_encode_message);
+			start_encode_message.AddBool("shell", fMenuShellCommandline->IsMarked());
+			start_encode_message.AddInt32("duration", fEncodeDuration);
+			fEncoder->PostMessage(&start_encode_message);
 			fEncodeTime = 0;
 			break;
 		}
@@ -553,7 +721,8 @@ MainWindow::MessageReceived(BMessage* message)
 				fStopAlert->Go(&fAlertInvoker);
 			} else {
 				BMessage stop_encode_message(M_STOP_COMMAND);
-				fCommandLauncher->PostMessage(&stop_encode_message);
+				stop_encode_message.AddBool("graceful", true);
+				fEncoder->PostMessage(&stop_encode_message);
 				fEncodeStartTime = 0; // 0 means: no encoding in progress
 			}
 			break;
@@ -565,7 +734,8 @@ MainWindow::MessageReceived(BMessage* message)
 			message->FindInt32("which", &selection);
 			if (selection == 1) {
 				BMessage stop_encode_message(M_STOP_COMMAND);
-				fCommandLauncher->PostMessage(&stop_encode_message);
+				stop_encode_message.AddBool("graceful", true);
+				fEncoder->PostMessage(&stop_encode_message);
 				fEncodeStartTime = 0; // 0 means: no encoding in progress
 			}
 			break;
@@ -577,29 +747,51 @@ MainWindow::MessageReceived(BMessage* message)
 			message->FindInt32("which", &selection);
 			if (selection == 1) {
 				BMessage stop_encode_message(M_STOP_COMMAND);
-				fCommandLauncher->PostMessage(&stop_encode_message);
+				fEncoder->PostMessage(&stop_encode_message);
 				fEncodeStartTime = 0; // 0 means: no encoding in progress
 				be_app->PostMessage(B_QUIT_REQUESTED);
 			} else
 				fAlertInvoker.SetMessage(new BMessage(M_STOP_ALERT_BUTTON));
 			break;
 		}
+		case M_PAUSE_ENCODING:
+		{
+			// ffmpeg is stopped and continued, e.g. to have the CPU for
+			// something else for a while
+			if (fEncodeStartTime == 0)
+				break;
+
+			fEncodePaused = !fEncodePaused;
+			fEncoder->PostMessage(fEncodePaused ? M_PAUSE_COMMAND : M_RESUME_COMMAND);
+			fMenuPauseEncode->SetLabel(fEncodePaused
+				? B_TRANSLATE("Resume encoding") : B_TRANSLATE("Pause encoding"));
+
+			BMessage progress_update_message(B_UPDATE_STATUS_BAR);
+			progress_update_message.AddFloat("delta", 0);
+			progress_update_message.AddString("trailing_text",
+				fEncodePaused ? B_TRANSLATE("Paused") : "");
+			PostMessage(&progress_update_message, fStatusBar);
+			break;
+		}
 		case M_ENCODE_PROGRESS:
 		{
 			BString progress_data;
-			message->FindString("data", &progress_data);
-			progress_data << "\n";
-			fLogView->Insert(progress_data.String());
-			fLogView->ScrollTo(0.0, 1000000.0);
+			if (message->FindString("data", &progress_data) == B_OK) {
+				// ffmpeg ends its status lines with a carriage return
+				progress_data.ReplaceAll('\r', '\n');
+				fLogView->Insert(progress_data.String());
+				fLogView->ScrollTo(0.0, 1000000.0);
+			}
 
-			int32 seconds;
-			message->FindInt32("time", &seconds);
+			bigtime_t time_us;
+			if (message->FindInt64("time_us", &time_us) != B_OK)
+				time_us = -1;
 			// calculate progress percentage
-			if (seconds > -1) {
-				fEncodeTime = seconds;
+			if (time_us > -1 && !fEncodePaused) {
+				fEncodeTime = time_us / 1000000;
 				int32 encode_percentage;
 				if (fEncodeDuration > 0)
-					encode_percentage = (fEncodeTime * 100) / fEncodeDuration;
+					encode_percentage = std::min((bigtime_t)100, time_us / ((bigtime_t)fEncodeDuration * 10000));
 				else
 					encode_percentage = 0;
 
@@ -608,6 +800,22 @@ MainWindow::MessageReceived(BMessage* message)
 					"delta", encode_percentage - fStatusBar->CurrentValue());
 				BString percentage_string;
 				percentage_string << encode_percentage << "%";
+
+				// The time left is estimated from the time spent so far,
+				// without the time the encoding was paused
+				bigtime_t active_us;
+				if (fEncodeDuration > 0 && time_us > 0
+					&& message->FindInt64("active_us", &active_us) == B_OK) {
+					double remaining = (double)active_us
+						* ((double)fEncodeDuration * 1000000 - time_us) / time_us;
+					if (remaining > 0) {
+						char timeText[16];
+						seconds_to_string(remaining / 1000000, timeText, sizeof(timeText));
+						BString left_string(B_TRANSLATE("%time% left"));
+						left_string.ReplaceFirst("%time%", timeText);
+						percentage_string << "  (" << left_string << ")";
+					}
+				}
 				progress_update_message.AddString("trailing_text", percentage_string.String());
 				PostMessage(&progress_update_message, fStatusBar);
 			}
@@ -621,6 +829,9 @@ MainWindow::MessageReceived(BMessage* message)
 			fStartAbortButton->SetMessage(new BMessage(M_ENCODE));
 			fMenuStartEncode->SetEnabled(true);
 			fMenuStopEncode->SetEnabled(false);
+			fMenuPauseEncode->SetEnabled(false);
+			fMenuPauseEncode->SetLabel(B_TRANSLATE("Pause encoding"));
+			fEncodePaused = false;
 
 			fStatusBar->Reset();
 			fStatusBar->SetText(B_TRANSLATE_NOCOLLECT(kIdleText));
@@ -633,9 +844,62 @@ MainWindow::MessageReceived(BMessage* message)
 			status_t exit_code;
 			message->FindInt32("exitcode", &exit_code);
 
+			// the time from aborting to ffmpeg having quit
+			bigtime_t stop_latency;
+			if (message->FindInt64("stop_latency", &stop_latency) == B_OK) {
+				BString stop_string(B_TRANSLATE("\nAborted: ffmpeg quit after %time% ms\n"));
+				stop_string.ReplaceFirst("%time%", BString() << stop_latency / 1000);
+				fLogView->Insert(fLogView->TextLength(), stop_string.String(),
+					stop_string.Length());
+			}
+
 			if (exit_code == ABORTED)
 				break;
 
+			// ffmpeg finished the output up to where it was stopped
+			if (exit_code == STOPPED) {
+				char timeText[16];
+				seconds_to_string(message->GetInt64("time_us", 0) / 1000000, timeText,
+					sizeof(timeText));
+				BString partial_string(B_TRANSLATE("The output is playable up to %time%.\n"));
+				partial_string.ReplaceFirst("%time%", timeText);
+				fLogView->Insert(fLogView->TextLength(), partial_string.String(),
+					partial_string.Length());
+				fLogView->ScrollTo(0.0, 1000000.0);
+				_SetPlaybuttonsState();
+				break;
+			}
+
+			bigtime_t elapsed;
+			if (message->FindInt64("elapsed", &elapsed) == B_OK) {
+				char timeText[16];
+				seconds_to_string(elapsed / 1000000, timeText, sizeof(timeText));
+				BString time_string(B_TRANSLATE("Encoding time: %time%"));
+				time_string.ReplaceFirst("%time%", timeText);
+
+				int32 segments = message->GetInt32("segments", 1);
+				if (segments > 1) {
+					BString segment_string(B_TRANSLATE(" (%count% segments)"));
+					segment_string.ReplaceFirst("%count%", BString() << segments);
+					time_string << segment_string;
+				}
+
+				int32 updates = message->GetInt32("updates", 0);
+				int32 messages = message->GetInt32("messages", 0);
+				if (messages > 0) {
+					BString update_string(
+						B_TRANSLATE("Progress: %updates% updates in %messages% messages"));
+					update_string.ReplaceFirst("%updates%", BString() << updates);
+					update_string.ReplaceFirst("%messages%", BString() << messages);
+					time_string << "\n" << update_string;
+				}
+				time_string.Prepend("\n");
+				time_string << "\n";
+				fLogView->Insert(fLogView->TextLength(), time_string.String(),
+					time_string.Length());
+				fLogView->ScrollTo(0.0, 1000000.0);
+			}
+
 			BNotification encodeFinished(B_INFORMATION_NOTIFICATION);
 			encodeFinished.SetGroup(B_TRANSLATE_SYSTEM_NAME("ffmpeg GUI"));
 			BString title(B_TRANSLATE("Encoding"));
@@ -659,7 +923,13 @@ MainWindow::MessageReceived(BMessage* message)
 				}
 				_SetPlaybuttonsState();
 			} else {
-				encodeFinished.SetContent(B_TRANSLATE("Encoding failed."));
+				BString content(B_TRANSLATE("Encoding failed."));
+				int32 error = message->GetInt32("error", ERROR_NONE);
+				if (error != ERROR_NONE) {
+					content = B_TRANSLATE("Encoding failed: %error%.");
+					content.ReplaceFirst("%error%", ErrorMatcher::ErrorDescription(error));
+				}
+				encodeFinished.SetContent(content);
 				fTabView->Select(LOG);
 				fLogView->ScrollTo(0.0, 1000000.0);
 			}
@@ -688,16 +958,25 @@ MainWindow::MessageReceived(BMessage* message)
 			_PlayVideo(fOutputTextControl->Text());
 			break;
 		}
-		case M_EXTRACTIMAGE_FINISHED:
+		case M_PREVIEW_FRAME:
 		{
-			fCropView->LoadImage(fPreviewPath.Path());
+			BBitmap* image = NULL;
+			if (message->FindPointer("bitmap", (void**)&image) == B_OK
+				&& fCropView->SetImage(image) == B_OK) {
+				BString time_string(B_TRANSLATE("Preview: frame ready in %time% ms"));
+				time_string.ReplaceFirst("%time%",
+					BString() << message->GetInt64("elapsed", 0) / 1000);
+				time_string << "\n";
+				fLogView->Insert(fLogView->TextLength(), time_string.String(),
+					time_string.Length());
+			}
 			fNewPreviewButton->SetEnabled(true);
 			break;
 		}
 		case M_NEW_PREVIEW:
 		{
 			fNewPreviewButton->SetEnabled(false);
-			_ExtractPreviewImage();
+			fPreviewPool->PostMessage(M_PREVIEW_REQUEST);
 			break;
 		}
 		case M_HELP:
@@ -714,6 +993,9 @@ MainWindow::MessageReceived(BMessage* message)
 		}
 		case B_REFS_RECEIVED:
 		{
+			if (_AddBatchJobs(message))
+				break;
+
 			entry_ref file_ref;
 			if (message->FindRef("refs", &file_ref) == B_OK) {
 				BEntry file_entry(&file_ref, true);
@@ -726,6 +1008,9 @@ MainWindow::MessageReceived(BMessage* message)
 		}
 		case B_SIMPLE_DATA:
 		{
+			if (_AddBatchJobs(message))
+				break;
+
 			BPoint drop_point;
 			entry_ref file_ref;
 			message->FindPoint("_drop_point_", &drop_point);
@@ -815,6 +1100,11 @@ MainWindow::_SaveSettings()
 	status = settings.AddRect("main_window", Frame());
 	status = settings.AddRect("job_window", fJobWindow->Frame());
 	status = settings.AddMessage("column settings", fJobWindow->GetColumnState());
+	status = settings.AddInt32("job_concurrency", fJobWindow->Concurrency());
+	status = settings.AddInt32("job_policy", fJobWindow->Policy());
+	status = settings.AddBool("job_resumable", fJobWindow->Resumable());
+	status = settings.AddBool("segmented_encoding", fMenuSegmentedEncoding->IsMarked());
+	status = settings.AddBool("shell_commandline", fMenuShellCommandline->IsMarked());
 
 	if (status == B_OK)
 		status = settings.Flatten(&file);
@@ -865,11 +1155,141 @@ MainWindow::_ArchiveJob()
 	jobMessage.AddInt32("channels", fChannelCount->Value());
 
 	jobMessage.AddString("commandline", fCommandlineTextControl->Text());
+	jobMessage.AddBool("shell", fMenuShellCommandline->IsMarked());
 
 	return jobMessage;
 }
 
 
+bool
+MainWindow::_AddBatchJobs(BMessage* message)
+{
+	// Several files, or folders, become one job each with the current
+	// settings. Single files are opened as source as usual.
+	BStringList paths;
+	bool folder = false;
+	entry_ref ref;
+	int32 count = 0;
+	for (; message->FindRef("refs", count, &ref) == B_OK; count++) {
+		BEntry entry(&ref, true);
+		BPath path(&entry);
+		if (!entry.IsDirectory()) {
+			paths.Add(path.Path());
+			continue;
+		}
+		folder = true;
+
+		BDirectory directory(&entry);
+		BEntry file;
+		while (directory.GetNextEntry(&file, true) == B_OK) {
+			BPath file_path(&file);
+			if (file.IsFile())
+				paths.Add(file_path.Path());
+		}
+	}
+
+	if (count < 2 && !folder)
+		return false;
+	if (paths.IsEmpty())
+		return true;
+
+	paths.Sort();
+	BMessage probe(M_BATCH_PROBE);
+	for (int32 i = 0; i < paths.CountStrings(); i++)
+		probe.AddString("path", paths.StringAt(i));
+	fProbePool->PostMessage(&probe);
+	fBatchJobCount = 0;
+	fBatchSpawnCount = 0;
+	fBatchSpawnTime = 0;
+
+	BString text(B_TRANSLATE("Adding %count% files as jobs" B_UTF8_ELLIPSIS "\n"));
+	text.ReplaceFirst("%count%", BString() << paths.CountStrings());
+	fLogView->Insert(fLogView->TextLength(), text.String(), text.Length());
+
+	if (fJobWindow->IsHidden())
+		fJobWindow->Show();
+	else
+		fJobWindow->Activate(true);
+
+	return true;
+}
+
+
+void
+MainWindow::_AddBatchJob(BMessage* message)
+{
+	BString source;
+	message->FindString("path", &source);
+
+	bigtime_t spawn_time;
+	if (message->FindInt64("spawn_time", &spawn_time) == B_OK) {
+		fBatchSpawnTime += spawn_time;
+		fBatchSpawnCount++;
+	}
+
+	BMessage archive;
+	MediaInfo info;
+	if (message->FindMessage("info", &archive) == B_OK)
+		info.Unarchive(&archive);
+
+	if (info.streams.empty()) {
+		BString text(B_TRANSLATE("Couldn't read media info of %file%\n"));
+		text.ReplaceFirst("%file%", source);
+		fLogView->Insert(fLogView->TextLength(), text.String(), text.Length());
+	} else {
+		// A job for this file, the same as if it was opened and added by hand
+		BString output(_OutputFilename(source));
+		// the archive keeps the commandline as the field would show it,
+		// only the job runs with "-y"
+		BString commandline(_CommandlineFor(source, output));
+		BString command(commandline);
+		command << " -y";
+
+		char duration[64];
+		seconds_to_string(int32(info.duration), duration, sizeof(duration));
+
+		BMessage jobMessage(_ArchiveJob());
+		jobMessage.ReplaceString("source", source);
+		jobMessage.ReplaceString("output", output);
+		jobMessage.ReplaceString("commandline", commandline);
+		// it's taken from the probe cache when the job is edited
+		jobMessage.RemoveName("mediainfo");
+
+		if (fJobWindow->Lock()) {
+			fJobWindow->AddJob(output.String(), duration, command.String(), jobMessage);
+			fJobWindow->Unlock();
+		}
+		fBatchJobCount++;
+	}
+
+	if (message->GetInt32("pending", 0) == 0) {
+		BString text(B_TRANSLATE("%count% jobs added\n"));
+		text.ReplaceFirst("%count%", BString() << fBatchJobCount);
+		if (fBatchSpawnCount > 0) {
+			BString spawn_text(B_TRANSLATE(
+				"Probes: %count% started in %time% µs on average\n"));
+			spawn_text.ReplaceFirst("%count%", BString() << fBatchSpawnCount);
+			spawn_text.ReplaceFirst("%time%",
+				BString() << fBatchSpawnTime / fBatchSpawnCount);
+			text << spawn_text;
+		}
+		fLogView->Insert(fLogView->TextLength(), text.String(), text.Length());
+	}
+}
+
+
+BString
+MainWindow::_CommandlineFor(const BString& source, const BString& output)
+{
+	// the current commandline with another input and output file
+	EncodeSpec spec;
+	spec.Parse(fCommandlineTextControl->Text());
+	spec.input = source;
+	spec.output = output;
+	return spec.Commandline();
+}
+
+
 void
 MainWindow::_UnarchiveJob(BMessage jobMessage)
 {
@@ -965,6 +1385,15 @@ MainWindow::_UnarchiveJob(BMessage jobMessage)
 	if (jobMessage.FindString("commandline", &text) == B_OK)
 		fCommandlineTextControl->SetText(text);
 
+	// Get the media info without probing, if the source is still the same.
+	// It's not adopted as default, that would overwrite the job's settings.
+	MediaInfo info;
+	if (fProbeCache->Lookup(fSourceTextControl->Text(), info)) {
+		fEncodeDuration = 0;
+		_ParseMediaOutput(info);
+		_UpdateMediaInfo();
+	}
+
 	_ToggleVideo();
 	_ToggleCropping();
 	_ToggleAudio();
@@ -1023,9 +1452,20 @@ MainWindow::_BuildMenu()
 		= new BMenuItem(B_TRANSLATE("Abort encoding"), new BMessage(M_STOP_ENCODING), 'A');
 	fMenuStopEncode->SetEnabled(false);
 	menu->AddItem(fMenuStopEncode);
+	fMenuPauseEncode
+		= new BMenuItem(B_TRANSLATE("Pause encoding"), new BMessage(M_PAUSE_ENCODING));
+	fMenuPauseEncode->SetEnabled(false);
+	menu->AddItem(fMenuPauseEncode);
 	menu->AddSeparatorItem();
 	item = new BMenuItem(B_TRANSLATE("Copy commandline"), new BMessage(M_COPY_COMMAND), 'L');
 	menu->AddItem(item);
+	menu->AddSeparatorItem();
+	fMenuSegmentedEncoding = new BMenuItem(B_TRANSLATE("Parallel segment encoding"),
+		new BMessage(M_SEGMENTED_ENCODING));
+	menu->AddItem(fMenuSegmentedEncoding);
+	fMenuShellCommandline = new BMenuItem(B_TRANSLATE("Run commandline in shell"),
+		new BMessage(M_SHELL_COMMANDLINE));
+	menu->AddItem(fMenuShellCommandline);
 	menuBar->AddItem(menu);
 
 	// Jobs menu
@@ -1274,6 +1714,7 @@ MainWindow::_BuildCroppingOptions()
 	fCropView = new CropView();
 	fResetCroppingButton = new BButton("", B_TRANSLATE("Reset"), new BMessage(M_RESET_CROPPING));
 	fNewPreviewButton = new BButton("", B_TRANSLATE("New preview"), new BMessage(M_NEW_PREVIEW));
+	fAutoCropButton = new BButton("", B_TRANSLATE("Auto crop"), new BMessage(M_AUTO_CROP));
 
 	BView* croppingoptionsview = new BView("", B_SUPPORTS_LAYOUT);
 	BLayoutBuilder::Group<>(croppingoptionsview, B_HORIZONTAL)
@@ -1292,7 +1733,10 @@ MainWindow::_BuildCroppingOptions()
 				.Add(fRightCrop->CreateLabelLayoutItem(), 0, 3)
 				.Add(fRightCrop->CreateTextViewLayoutItem(), 1, 3)
 			.End()
-			.Add(fResetCroppingButton)
+			.AddGroup(B_HORIZONTAL, B_USE_SMALL_SPACING)
+				.Add(fAutoCropButton)
+				.Add(fResetCroppingButton)
+			.End()
 			.AddGlue()
 		.End()
 		.Add(fCropView)
@@ -1402,67 +1846,38 @@ MainWindow::_BuildEncodeProgress()
 void
 MainWindow::_BuildLine() // update the ffmpeg commandline
 {
-	// split existing commandline into tokens
-	fCommand = fCommandlineTextControl->Text();
-	fCommand.Trim();
-	BStringList tokens_raw;
-	fCommand.Split(" ", true, tokens_raw);
-
-	// consolidate parts of quoted strings into single tokens
-	fCommandLineTokens.MakeEmpty();
-	for (int32 token_idx = 0; token_idx < tokens_raw.CountStrings(); ++token_idx) {
-		BString token = tokens_raw.StringAt(token_idx);
-		if (token.StartsWith("\"")) {
-			if (!token.EndsWith("\"")) {
-				for (int32 part_idx = token_idx+1; part_idx < tokens_raw.CountStrings(); ++part_idx) {
-					BString token_part = tokens_raw.StringAt(part_idx);
-					token << " " << token_part;
-					if (token_part.EndsWith("\"")) {
-						token_idx = part_idx;
-						break;
-					}
-				}
-			}
-		}
-		fCommandLineTokens.Add(token);
-	}
+	// The commandline is only parsed again if it was edited by hand,
+	// otherwise the spec still is what the field shows
+	if (fCommand != fCommandlineTextControl->Text())
+		fEncodeSpec.Parse(fCommandlineTextControl->Text());
 
 	BString value;
 
 	// make sure ffmpeg is at the start of the command
-	if (fCommandLineTokens.StringAt(0) != kFFMpeg)
-		fCommandLineTokens.Add(kFFMpeg, 0);
+	fEncodeSpec.program = kFFMpeg;
 
 	// input file
 	value = fSourceTextControl->Text();
-	value.Trim();
-	value.Prepend("\"");
-	value.Append("\"");
-	_SetParameter("-i", value);
+	fEncodeSpec.input = value.Trim();
 
 	// container format
 	int32 option_index = fFileFormatPopup->FindMarkedIndex();
-	_SetParameter("-f", fContainerFormats[option_index].Option);
+	fEncodeSpec.format = fContainerFormats[option_index].Option;
 
 	// video options
 	if ((fEnableVideoBox->Value() == B_CONTROL_ON) and (fEnableVideoBox->IsEnabled())) {
 		option_index = fVideoFormatPopup->FindMarkedIndex();
-		_RemoveParameter("-vn");
-		_SetParameter("-vcodec", fVideoCodecs[option_index].Option);
+		fEncodeSpec.video_enabled = true;
+		fEncodeSpec.video_codec = fVideoCodecs[option_index].Option;
 
 		if (option_index != 0) {
-			value = "";
-			value << fVideoBitrateSpinner->Value() << "k";
-			_SetParameter("-b:v", value);
-			value = "";
-			value << fFramerate->Value();
-			_SetParameter("-r", value);
-			if (fCustomResolutionBox->IsEnabled() && fCustomResolutionBox->Value()) {
-				value = "";
-				value << fXres->Value() << "x" << fYres->Value();
-				_SetParameter("-s", value);
-			} else
-				_RemoveParameter("-s");
+			fEncodeSpec.video_bitrate = "";
+			fEncodeSpec.video_bitrate << fVideoBitrateSpinner->Value() << "k";
+			fEncodeSpec.framerate = "";
+			fEncodeSpec.framerate << fFramerate->Value();
+			fEncodeSpec.size = "";
+			if (fCustomResolutionBox->IsEnabled() && fCustomResolutionBox->Value())
+				fEncodeSpec.size << fXres->Value() << "x" << fYres->Value();
 
 			// cropping options
 			int32 topcrop = fTopCrop->Value();
@@ -1475,145 +1890,98 @@ MainWindow::_BuildLine() // update the ffmpeg commandline
 				value << "crop=iw-" << leftcrop + rightcrop << ":ih-"
 						<< topcrop + bottomcrop << ":" << leftcrop
 						<< ":" << topcrop;
-				_SetParameter("-vf", value);
+				fEncodeSpec.SetFilter("crop", value);
 			} else
-				_RemoveParameter("-vf");
+				fEncodeSpec.RemoveFilter("crop");
 		} else {
-			_RemoveParameter("-b:v");
-			_RemoveParameter("-r");
-			_RemoveParameter("-s");
-			_RemoveParameter("-vf");
+			fEncodeSpec.video_bitrate = "";
+			fEncodeSpec.framerate = "";
+			fEncodeSpec.size = "";
+			fEncodeSpec.video_filters.MakeEmpty();
 		}
 	} else {
-		_RemoveParameter("-vcodec");
-		_SetParameter("-vn", "");
+		fEncodeSpec.video_enabled = false;
+		fEncodeSpec.video_codec = "";
 	}
 
 	//audio options
 	if (fEnableAudioBox->Value() == B_CONTROL_ON) {
 		option_index = fAudioFormatPopup->FindMarkedIndex();
-		_RemoveParameter("-an");
-		value = fAudioCodecs[option_index].Option;
-		_SetParameter("-acodec", value);
+		fEncodeSpec.audio_enabled = true;
+		fEncodeSpec.audio_codec = fAudioCodecs[option_index].Option;
 
 		if (option_index != 0) {
-			value = fAudioBitsPopup->FindMarked()->Label();
-			value << "k";
-			_SetParameter("-b:a", value);
-			value = fSampleratePopup->FindMarked()->Label();
-			_SetParameter("-ar", value);
-			value = "";
-			value << fChannelCount->Value();
-			_SetParameter("-ac", value);
-			_SetParameter("-strict", "-2"); // enable 'experimental codecs' needed for dca (DTS)
+			fEncodeSpec.audio_bitrate = fAudioBitsPopup->FindMarked()->Label();
+			fEncodeSpec.audio_bitrate << "k";
+			fEncodeSpec.samplerate = fSampleratePopup->FindMarked()->Label();
+			fEncodeSpec.channels = "";
+			fEncodeSpec.channels << fChannelCount->Value();
+			fEncodeSpec.strict = "-2"; // enable 'experimental codecs' needed for dca (DTS)
 		} else {
-			_RemoveParameter("-b:a");
-			_RemoveParameter("-ar");
-			_RemoveParameter("-ac");
+			fEncodeSpec.audio_bitrate = "";
+			fEncodeSpec.samplerate = "";
+			fEncodeSpec.channels = "";
 		}
 	} else {
-		_RemoveParameter("-acodec");
-		_RemoveParameter("-b:a");
-		_RemoveParameter("-ar");
-		_RemoveParameter("-ac");
-		_SetParameter("-an", "");
+		fEncodeSpec.audio_enabled = false;
+		fEncodeSpec.audio_codec = "";
+		fEncodeSpec.audio_bitrate = "";
+		fEncodeSpec.samplerate = "";
+		fEncodeSpec.channels = "";
 	}
 
 	//logging and output formatting
-	_SetParameter("-loglevel", "error");
-	_SetParameter("-stats","");
+	fEncodeSpec.loglevel = "error";
+	fEncodeSpec.stats = true;
 
 	// output file
-	BString output_filename = fOutputTextControl->Text();
-	output_filename.Trim();
-	output_filename.Prepend("\"");
-	output_filename.Append("\"");
-
-	// can´t use _SetParameter() here because the output file is specified without an option specifier
-	// for now we just assume that the output file is at the end of the command line and in double quotes
-	// this should definitely be improved in the future
-	int32 last_idx = fCommandLineTokens.CountStrings() - 1;
-	BString last_item = fCommandLineTokens.StringAt(last_idx);
-	if (last_item.StartsWith("\"") and last_item.EndsWith("\""))
-		fCommandLineTokens.Replace(last_idx, output_filename);
-	else
-		fCommandLineTokens.Add(output_filename);
-
-	// assemble the commandline from the token list and put it in the textcontrol
-	fCommand.SetTo("");
-
-	for (int32 i = 0; i < fCommandLineTokens.CountStrings(); ++i)
-		fCommand << fCommandLineTokens.StringAt(i) << " ";
+	value = fOutputTextControl->Text();
+	fEncodeSpec.output = value.Trim();
 
+	// put the commandline in the textcontrol
+	fCommand = fEncodeSpec.Commandline();
 	fCommandlineTextControl->SetText(fCommand);
 }
 
 
-void
-MainWindow::_SetParameter(const BString& name, const BString& value)
-{
-	if (!fCommandLineTokens.HasString(name)) {
-		BString last_token = fCommandLineTokens.Last();
-		if (last_token.StartsWith("\"") and last_token.EndsWith("\""))
-			fCommandLineTokens.Add(name, fCommandLineTokens.CountStrings() - 1);
-		else
-			fCommandLineTokens.Add(name);
-	}
-
-	if (!value.IsEmpty()) {
-		int32 param_index = fCommandLineTokens.IndexOf(name);
-		BString next_token = fCommandLineTokens.StringAt(param_index + 1);
-
-		if ((next_token.StartsWith("-") and !_IsDigit(next_token.ByteAt(1))))  // no parameter value
-			fCommandLineTokens.Add(value, param_index + 1);
-		else {
-			if (!fCommandLineTokens.Replace(param_index + 1, value))
-				fCommandLineTokens.Add(value, param_index + 1);
-		}
-	}
-}
-
-
-void
-MainWindow::_RemoveParameter(const BString& name)
-{
-	if (fCommandLineTokens.HasString(name)) {
-		int32 param_index = fCommandLineTokens.IndexOf(name);
-		if (!fCommandLineTokens.StringAt(param_index + 1).StartsWith("-"))
-			fCommandLineTokens.Remove(param_index + 1);
-
-		fCommandLineTokens.Remove(param_index);
-	}
-}
-
-
-bool
-MainWindow::_IsDigit(char c)
-{
-	return (('0' <= c ) && ( c <= '9'));
-}
-
-
 void
 MainWindow::_GetMediaInfo()
 {
 	// Reset media info and video/audio tags
-	fMediainfo = fVideoCodec = fAudioCodec = fVideoWidth = fVideoHeight = fVideoFramerate
+	fVideoCodec = fAudioCodec = fVideoWidth = fVideoHeight = fVideoFramerate
 		= fDuration = fVideoBitrate = fAudioBitrate = fAudioSamplerate = fAudioChannelLayout = "";
+	fMediaInfoParser.Reset();
+	fMediaParseTime = 0;
+	fProbedPath = fSourceTextControl->Text();
+	fProbeID++;
+
+	MediaInfo info;
+	if (fProbeCache->Lookup(fProbedPath, info)) {
+		BString cache_string(
+			B_TRANSLATE("Media info: from cache (%hits% hits, %misses% misses)\n"));
+		cache_string.ReplaceFirst("%hits%", BString() << fProbeCache->Hits());
+		cache_string.ReplaceFirst("%misses%", BString() << fProbeCache->Misses());
+		fLogView->Insert(fLogView->TextLength(), cache_string.String(),
+			cache_string.Length());
+
+		_MediaInfoReady(info);
+		return;
+	}
+
+	// One ffprobe for all streams and the container
 	BString command;
-	command << kFFProbe << " -v error -show_entries format=duration,bit_rate:"
-			   "stream=codec_name,width,height,r_frame_rate,sample_rate,"
-			   "channel_layout "
-			   "-of default=noprint_wrappers=1 -select_streams v:0 "
-			<< "\"" << fSourceTextControl->Text() << "\" ; ";
-	command << kFFProbe << " -v error -show_entries format=duration:"
-			   "stream=codec_name,sample_rate,channels,channel_layout,bit_rate "
-			   "-of default=noprint_wrappers=1 -select_streams a:0 "
-			<< "\"" << fSourceTextControl->Text() << "\"";
+	command << kFFProbe << " -v error -show_streams -show_format -of json";
+	BStringList arguments;
+	tokenize_commandline(command, arguments);
+	arguments.Add(fSourceTextControl->Text());
 
+	// Only the probe of the current source counts, an older one still
+	// running or waiting is stopped
 	BMessage get_info_message(M_INFO_COMMAND);
-	get_info_message.AddString("cmdline", command);
-	fCommandLauncher->PostMessage(&get_info_message);
+	get_info_message.AddStrings("argv", arguments);
+	get_info_message.AddInt32("id", fProbeID);
+	get_info_message.AddBool("latest", true);
+	fInfoLauncher->PostMessage(&get_info_message);
 }
 
 
@@ -1680,74 +2048,70 @@ MainWindow::_UpdateMediaInfo()
 
 
 void
-MainWindow::_ParseMediaOutput()
+MainWindow::_MediaInfoReady(const MediaInfo& info)
 {
-	BStringList list;
-	fMediainfo.ReplaceAll("\n", "=");
-	fMediainfo.Split("=", true, list);
-
-	if (list.HasString("width")) { // video stream is always first
-		int32 index = list.IndexOf("codec_name");
-		fVideoCodec = list.StringAt(index + 1);
-		// Remove in case of 2nd "codec_name" of audio stream
-		list.Remove(index);
-
-		fVideoWidth = list.StringAt(list.IndexOf("width") + 1);
-		fVideoHeight = list.StringAt(list.IndexOf("height") + 1);
-		fVideoFramerate = list.StringAt(list.IndexOf("r_frame_rate") + 1);
-
-		fDuration = list.StringAt(list.IndexOf("duration") + 1);
-
-		index = list.IndexOf("bit_rate");
-		fVideoBitrate = list.StringAt(index + 1);
-		// Remove in case of 2nd "bit_rate" of audio stream
-		list.Remove(index);
-	}
-	if (list.HasString("sample_rate")) { // audio stream is second
-		fAudioCodec = list.StringAt(list.IndexOf("codec_name") + 1);
-		fAudioSamplerate = list.StringAt(list.IndexOf("sample_rate") + 1);
-		fAudioChannels = list.StringAt(list.IndexOf("channels") + 1);
-		fAudioChannelLayout = list.StringAt(list.IndexOf("channel_layout") + 1);
+	fEncodeDuration = 0;
+	_ParseMediaOutput(info);
+	_UpdateMediaInfo();
+	_AdoptDefaults();
+	_ExtractPreviewImage();
+}
 
-		if (fDuration == "") // if audio-only (not filled by video ffprobe above)
-			fDuration = list.StringAt(list.IndexOf("duration") + 1);
 
-		int32 index = list.IndexOf("bit_rate");
-		fAudioBitrate = list.StringAt(index + 1);
+void
+MainWindow::_ParseMediaOutput(const MediaInfo& info)
+{
+	const StreamInfo* video = info.FirstStream("video");
+	const StreamInfo* audio = info.FirstStream("audio");
+
+	if (video != NULL) {
+		fVideoCodec = video->codec_name;
+		fVideoWidth = _InfoValue(video->width);
+		fVideoHeight = _InfoValue(video->height);
+		fVideoFramerate = video->r_frame_rate;
+		// Not every container has the bitrate of the stream
+		fVideoBitrate = _InfoValue(video->bit_rate >= 0 ? video->bit_rate : info.bit_rate);
+	}
+	if (audio != NULL) {
+		fAudioCodec = audio->codec_name;
+		fAudioSamplerate = _InfoValue(audio->sample_rate);
+		fAudioChannels = _InfoValue(audio->channels);
+		fAudioChannelLayout = audio->channel_layout;
+		fAudioBitrate = _InfoValue(audio->bit_rate);
+	}
+	if (video != NULL || audio != NULL) {
+		if (info.duration >= 0)
+			fDuration.SetToFormat("%f", info.duration);
+		else
+			fDuration = "N/A";
 	}
 }
 
 
+BString
+MainWindow::_InfoValue(int64 value)
+{
+	BString string;
+	if (value < 0)
+		string = "N/A";
+	else
+		string << value;
+	return string;
+}
+
+
 void
 MainWindow::_ExtractPreviewImage()
 {
-	BMessage extract_image_message(M_EXTRACTIMAGE_COMMAND);
-	BPath source_path(fSourceTextControl->Text());
-	find_directory(B_SYSTEM_TEMP_DIRECTORY, &fPreviewPath);
-	BString preview_filename(source_path.Leaf());
-	preview_filename.Append("_preview.jpg");
-	preview_filename.Prepend("ffmpegGUI_");
-	fPreviewPath.Append(preview_filename);
-
-	// skip first and last second of the clip (often black)
-	int32 min = 1;
-	int32 max = fEncodeDuration - 1;
-	// Generate random time for clips > 1 second
-	int32 randomSecond = 0;
-	if (max > 0) {
-		srand(system_time());
-		while ((randomSecond = min + (rand() % static_cast<int>(max - min + 1))) == fLastRandomSecond);
-		fLastRandomSecond = randomSecond;
-	}
-	// Convert seconds to HH:MM:SS
-	char randomTime[64];
-	seconds_to_string(randomSecond, randomTime, sizeof(randomTime));
-
-	BString extract_image_cmd;
-	extract_image_cmd	<< "ffmpeg -y -ss " << randomTime << " -i \"" << source_path.Path()
-						<< "\" -qscale:v 2 -vframes 1 \"" << fPreviewPath.Path() << "\"";
-	extract_image_message.AddString("cmdline", extract_image_cmd);
-	fCommandLauncher->PostMessage(&extract_image_message);
+	// Frames are extracted in the background, at the size of the source
+	// as the crop values refer to that
+	BMessage source_message(M_PREVIEW_SOURCE);
+	source_message.AddString("path", fSourceTextControl->Text());
+	source_message.AddInt32("duration", fEncodeDuration);
+	source_message.AddInt32("width", atoi(fVideoWidth.String()));
+	source_message.AddInt32("height", atoi(fVideoHeight.String()));
+	fPreviewPool->PostMessage(&source_message);
+	fPreviewPool->PostMessage(M_PREVIEW_REQUEST);
 }
 
 
@@ -1907,17 +2271,24 @@ MainWindow::_SetFileExtension()
 	if (output_filename == "")
 		output_filename = fSourceTextControl->Text();
 
-	int32 begin_ext = output_filename.FindLast(".");
+	fOutputTextControl->SetText(_OutputFilename(output_filename));
+}
+
+
+BString
+MainWindow::_OutputFilename(BString filename)
+{
+	int32 begin_ext = filename.FindLast(".");
 	// cut away extension if it already exists
 	if (begin_ext != B_ERROR) {
 		++begin_ext;
-		output_filename.RemoveChars(begin_ext, output_filename.Length() - begin_ext);
+		filename.RemoveChars(begin_ext, filename.Length() - begin_ext);
 	} else
-		output_filename.Append(".");
+		filename.Append(".");
 
 	int32 option_index = fFileFormatPopup->FindMarkedIndex();
-	output_filename.Append(fContainerFormats[option_index].Extension);
-	fOutputTextControl->SetText(output_filename);
+	filename.Append(fContainerFormats[option_index].Extension);
+	return filename;
 }
 
 
@@ -2091,6 +2462,7 @@ MainWindow::_ToggleCropping()
 	fRightCrop->SetEnabled(cropping_options_enabled);
 	fCropView->SetEnabled(cropping_options_enabled);
 	fResetCroppingButton->SetEnabled(cropping_options_enabled);
+	fAutoCropButton->SetEnabled(cropping_options_enabled);
 	fNewPreviewButton->SetEnabled(cropping_options_enabled);
 	fCroppingTab->SetEnabled(cropping_options_enabled);
 	fTabView->Invalidate();
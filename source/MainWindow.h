@@ -12,6 +12,9 @@
 #define MAINWINDOW_H
 
 
+#include "EncodeSpec.h"
+#include "MediaInfo.h"
+
 #include <Invoker.h>
 #include <Path.h>
 #include <Window.h>
@@ -26,6 +29,7 @@ class BDecimalSpinner;
 class BFilePanel;
 class BMenuBar;
 class BMenuField;
+class BMessageRunner;
 class BPath;
 class BPopUpMenu;
 class BSpinner;
@@ -44,7 +48,12 @@ class CommandLauncher;
 class Spinner;
 class DecSpinner;
 class JobWindow;
+class PreviewPool;
+class ProbeCache;
+class ProbePool;
+class CropDetector;
 class CropView;
+class SegmentEncoder;
 
 
 class MainWindow : public BWindow {
@@ -60,6 +69,9 @@ private:
 
 	BMessage		_ArchiveJob();
 	void			_UnarchiveJob(BMessage jobMessage);
+	bool			_AddBatchJobs(BMessage* message);
+	void			_AddBatchJob(BMessage* message);
+	BString			_CommandlineFor(const BString& source, const BString& output);
 
 	BMenuBar*		_BuildMenu();
 	BView* 			_BuildFileOptions();
@@ -70,13 +82,12 @@ private:
 	BView*  		_BuildEncodeProgress();
 
 	void 			_BuildLine();
-	void			_SetParameter(const BString& name, const BString& value);
-	void 			_RemoveParameter(const BString& name);
-	bool			_IsDigit(char c);
 
 	void 			_GetMediaInfo();
 	void 			_UpdateMediaInfo();
-	void 			_ParseMediaOutput();
+	void			_MediaInfoReady(const MediaInfo& info);
+	void 			_ParseMediaOutput(const MediaInfo& info);
+	BString			_InfoValue(int64 value);
 
 	void 			_ExtractPreviewImage();
 	void			_DeleteTempFiles();
@@ -88,6 +99,7 @@ private:
 
 	bool			_FileExists(const char* filepath);
 	void 			_SetFileExtension();
+	BString			_OutputFilename(BString filename);
 	void 			_SetFiletype(entry_ref* ref);
 
 	void 			_ReadyToEncode();
@@ -107,7 +119,8 @@ private:
 
 	// misc views
 	CropView*		fCropView;
-	int32 			fLastRandomSecond;
+	PreviewPool*	fPreviewPool;
+	CropDetector*	fCropDetector;
 
 	// text controls
 	BTextControl* 	fSourceTextControl;
@@ -122,6 +135,7 @@ private:
 	BButton* 		fStartAbortButton;
 	BButton* 		fResetCroppingButton;
 	BButton* 		fNewPreviewButton;
+	BButton*		fAutoCropButton;
 
 	// spin buttons
 	Spinner* 	fVideoBitrateSpinner;
@@ -180,21 +194,35 @@ private:
 	BCheckBox* 		fPlayFinishedBox;
 	BStatusBar* 	fStatusBar;
 	time_t 			fEncodeStartTime;
+	bool			fEncodePaused;
 
 	// menu bar
 	BMenuItem* 		fMenuPlaySource;
 	BMenuItem* 		fMenuPlayOutput;
 	BMenuItem* 		fMenuStartEncode;
 	BMenuItem* 		fMenuStopEncode;
+	BMenuItem*		fMenuPauseEncode;
 	BMenuItem* 		fMenuAddJob;
 	BMenuItem* 		fMenuDefaults;
+	BMenuItem* 		fMenuSegmentedEncoding;
+	BMenuItem*		fMenuShellCommandline;
 
 	// bstrings
 	BString 		fCommand;
-	BString 		fMediainfo;
-	BStringList		fCommandLineTokens;
+	EncodeSpec		fEncodeSpec;
 
 	// ffprobe stream tags
+	MediaInfoParser	fMediaInfoParser;
+	bigtime_t		fMediaParseTime;
+	BString			fProbedPath;
+	int32			fProbeID;
+	BMessageRunner*	fSourceRunner;
+	int32			fProbesAvoided;
+	ProbeCache*		fProbeCache;
+	ProbePool*		fProbePool;
+	int32			fBatchJobCount;
+	int32			fBatchSpawnCount;
+	bigtime_t		fBatchSpawnTime;
 	BString 		fVideoCodec;
 	BString 		fAudioCodec;
 	BString 		fVideoWidth;
@@ -211,7 +239,6 @@ private:
 	BFilePanel* 	fSourceFilePanel;
 	BFilePanel* 	fOutputFilePanel;
 
-	BPath			fPreviewPath;
 	// alerts
 	BAlert* 		fStopAlert;
 	BInvoker 		fAlertInvoker;
@@ -221,7 +248,11 @@ private:
 	std::vector<CodecOption> fVideoCodecs;
 	std::vector<CodecOption> fAudioCodecs;
 
+	// encodes, and probes of the source, which shouldn't wait for an encode
 	CommandLauncher* fCommandLauncher;
+	CommandLauncher* fInfoLauncher;
+	SegmentEncoder*	fSegmentEncoder;
+	BLooper*		fEncoder;
 	JobWindow*		fJobWindow;
 };
 
@@ -0,0 +1,363 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+
+
+#include "MediaInfo.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+
+StreamInfo::StreamInfo()
+	:
+	index(-1),
+	width(-1),
+	height(-1),
+	nb_frames(-1),
+	sample_rate(-1),
+	channels(-1),
+	bit_rate(-1),
+	duration(-1)
+{
+}
+
+
+status_t
+StreamInfo::Archive(BMessage* archive) const
+{
+	archive->AddInt32("index", index);
+	archive->AddString("codec_type", codec_type);
+	archive->AddString("codec_name", codec_name);
+	archive->AddInt32("width", width);
+	archive->AddInt32("height", height);
+	archive->AddString("pix_fmt", pix_fmt);
+	archive->AddString("field_order", field_order);
+	archive->AddString("r_frame_rate", r_frame_rate);
+	archive->AddInt64("nb_frames", nb_frames);
+	archive->AddInt32("sample_rate", sample_rate);
+	archive->AddInt32("channels", channels);
+	archive->AddString("channel_layout", channel_layout);
+	archive->AddInt64("bit_rate", bit_rate);
+	return archive->AddDouble("duration", duration);
+}
+
+
+status_t
+StreamInfo::Unarchive(const BMessage* archive)
+{
+	index = archive->GetInt32("index", -1);
+	codec_type = archive->GetString("codec_type", "");
+	codec_name = archive->GetString("codec_name", "");
+	width = archive->GetInt32("width", -1);
+	height = archive->GetInt32("height", -1);
+	pix_fmt = archive->GetString("pix_fmt", "");
+	field_order = archive->GetString("field_order", "");
+	r_frame_rate = archive->GetString("r_frame_rate", "");
+	nb_frames = archive->GetInt64("nb_frames", -1);
+	sample_rate = archive->GetInt32("sample_rate", -1);
+	channels = archive->GetInt32("channels", -1);
+	channel_layout = archive->GetString("channel_layout", "");
+	bit_rate = archive->GetInt64("bit_rate", -1);
+	duration = archive->GetDouble("duration", -1);
+	return B_OK;
+}
+
+
+MediaInfo::MediaInfo()
+{
+	MakeEmpty();
+}
+
+
+void
+MediaInfo::MakeEmpty()
+{
+	streams.clear();
+	format_name = "";
+	bit_rate = -1;
+	duration = -1;
+}
+
+
+status_t
+MediaInfo::Archive(BMessage* archive) const
+{
+	for (size_t i = 0; i < streams.size(); i++) {
+		BMessage stream;
+		streams[i].Archive(&stream);
+		archive->AddMessage("stream", &stream);
+	}
+	archive->AddString("format_name", format_name);
+	archive->AddInt64("bit_rate", bit_rate);
+	return archive->AddDouble("duration", duration);
+}
+
+
+status_t
+MediaInfo::Unarchive(const BMessage* archive)
+{
+	MakeEmpty();
+
+	BMessage stream;
+	for (int32 i = 0; archive->FindMessage("stream", i, &stream) == B_OK; i++) {
+		streams.push_back(StreamInfo());
+		streams.back().Unarchive(&stream);
+	}
+	format_name = archive->GetString("format_name", "");
+	bit_rate = archive->GetInt64("bit_rate", -1);
+	duration = archive->GetDouble("duration", -1);
+	return B_OK;
+}
+
+
+const StreamInfo*
+MediaInfo::FirstStream(const char* type) const
+{
+	for (size_t i = 0; i < streams.size(); i++) {
+		if (streams[i].codec_type == type)
+			return &streams[i];
+	}
+	return NULL;
+}
+
+
+MediaInfoParser::MediaInfoParser()
+{
+	Reset();
+}
+
+
+void
+MediaInfoParser::Reset()
+{
+	fInfo.MakeEmpty();
+	fState = VALUE;
+	fToken = "";
+	fExpectKey = false;
+	fDepth = 0;
+	fStarted = false;
+	fError = false;
+}
+
+
+void
+MediaInfoParser::Feed(const char* data, size_t length)
+{
+	for (size_t i = 0; i < length && !fError; i++) {
+		char c = data[i];
+
+		switch (fState) {
+			case STRING:
+				if (c == '"') {
+					fState = VALUE;
+					_Scalar(fToken, true);
+				} else if (c == '\\')
+					fState = STRING_ESCAPE;
+				else
+					fToken += c;
+				break;
+
+			case STRING_ESCAPE:
+				fState = STRING;
+				switch (c) {
+					case 'b': fToken += '\b'; break;
+					case 'f': fToken += '\f'; break;
+					case 'n': fToken += '\n'; break;
+					case 'r': fToken += '\r'; break;
+					case 't': fToken += '\t'; break;
+					case 'u':
+						fUnicode = 0;
+						fUnicodeDigits = 0;
+						fState = STRING_UNICODE;
+						break;
+					default: fToken += c; break;
+				}
+				break;
+
+			case STRING_UNICODE:
+			{
+				int32 digit = -1;
+				if (c >= '0' && c <= '9')
+					digit = c - '0';
+				else if (c >= 'a' && c <= 'f')
+					digit = c - 'a' + 10;
+				else if (c >= 'A' && c <= 'F')
+					digit = c - 'A' + 10;
+				if (digit < 0) {
+					fError = true;
+					break;
+				}
+				fUnicode = fUnicode * 16 + digit;
+				if (++fUnicodeDigits < 4)
+					break;
+
+				// encode as UTF-8, surrogate pairs aren't combined
+				if (fUnicode < 0x80)
+					fToken += (char)fUnicode;
+				else if (fUnicode < 0x800) {
+					fToken += (char)(0xc0 | (fUnicode >> 6));
+					fToken += (char)(0x80 | (fUnicode & 0x3f));
+				} else {
+					fToken += (char)(0xe0 | (fUnicode >> 12));
+					fToken += (char)(0x80 | ((fUnicode >> 6) & 0x3f));
+					fToken += (char)(0x80 | (fUnicode & 0x3f));
+				}
+				fState = STRING;
+				break;
+			}
+
+			case LITERAL:
+				if (isalnum(c) || c == '.' || c == '-' || c == '+') {
+					fToken += c;
+					break;
+				}
+				fState = VALUE;
+				_Scalar(fToken, false);
+				// the delimiter is handled below
+				// fall through
+
+			case VALUE:
+				switch (c) {
+					case '{':
+						_Push(true);
+						break;
+					case '[':
+						_Push(false);
+						break;
+					case '}':
+					case ']':
+						_Pop();
+						break;
+					case '"':
+						fToken = "";
+						fState = STRING;
+						break;
+					case ':':
+						fExpectKey = false;
+						break;
+					case ',':
+						fExpectKey = fDepth > 0 && fIsObject[fDepth - 1];
+						break;
+					case ' ':
+					case '\t':
+					case '\n':
+					case '\r':
+						break;
+					default:
+						fToken = "";
+						fToken += c;
+						fState = LITERAL;
+						break;
+				}
+				break;
+		}
+	}
+}
+
+
+void
+MediaInfoParser::_Push(bool object)
+{
+	if (fDepth == kMaxDepth) {
+		fError = true;
+		return;
+	}
+
+	// a new object in the root's "streams" array is the next stream
+	if (object && fDepth == 2 && fKey[0] == "streams")
+		fInfo.streams.push_back(StreamInfo());
+
+	fIsObject[fDepth] = object;
+	fKey[fDepth] = "";
+	fDepth++;
+	fExpectKey = object;
+	fStarted = true;
+}
+
+
+void
+MediaInfoParser::_Pop()
+{
+	if (fDepth == 0) {
+		fError = true;
+		return;
+	}
+	fDepth--;
+	fExpectKey = false;
+}
+
+
+void
+MediaInfoParser::_Scalar(const BString& value, bool isString)
+{
+	if (fDepth == 0)
+		return;
+
+	if (fExpectKey) {
+		fKey[fDepth - 1] = value;
+		fExpectKey = false;
+		return;
+	}
+
+	// "null" isn't a value we keep
+	if (!isString && value == "null")
+		return;
+
+	// root { "streams": [ { key: value } ], "format": { key: value } }
+	if (fDepth == 3 && fKey[0] == "streams" && !fIsObject[1]
+		&& !fInfo.streams.empty())
+		_SetStreamValue(fInfo.streams.back(), fKey[2], value);
+	else if (fDepth == 2 && fKey[0] == "format")
+		_SetFormatValue(fKey[1], value);
+}
+
+
+void
+MediaInfoParser::_SetStreamValue(StreamInfo& stream, const BString& key,
+	const BString& value)
+{
+	// ffprobe quotes most numbers, so all values come in as strings
+	if (key == "index")
+		stream.index = atoi(value);
+	else if (key == "codec_type")
+		stream.codec_type = value;
+	else if (key == "codec_name")
+		stream.codec_name = value;
+	else if (key == "width")
+		stream.width = atoi(value);
+	else if (key == "height")
+		stream.height = atoi(value);
+	else if (key == "pix_fmt")
+		stream.pix_fmt = value;
+	else if (key == "field_order")
+		stream.field_order = value;
+	else if (key == "r_frame_rate")
+		stream.r_frame_rate = value;
+	else if (key == "nb_frames")
+		stream.nb_frames = atoll(value);
+	else if (key == "sample_rate")
+		stream.sample_rate = atoi(value);
+	else if (key == "channels")
+		stream.channels = atoi(value);
+	else if (key == "channel_layout")
+		stream.channel_layout = value;
+	else if (key == "bit_rate")
+		stream.bit_rate = atoll(value);
+	else if (key == "duration")
+		stream.duration = atof(value);
+}
+
+
+void
+MediaInfoParser::_SetFormatValue(const BString& key, const BString& value)
+{
+	if (key == "format_name")
+		fInfo.format_name = value;
+	else if (key == "bit_rate")
+		fInfo.bit_rate = atoll(value);
+	else if (key == "duration")
+		fInfo.duration = atof(value);
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+#ifndef MEDIAINFO_H
+#define MEDIAINFO_H
+
+
+#include <Message.h>
+#include <String.h>
+#include <SupportDefs.h>
+
+#include <vector>
+
+
+// Values ffprobe doesn't report are empty strings or -1
+struct StreamInfo {
+					StreamInfo();
+
+	status_t		Archive(BMessage* archive) const;
+	status_t		Unarchive(const BMessage* archive);
+
+	int32			index;
+	BString			codec_type;
+	BString			codec_name;
+
+	// video
+	int32			width;
+	int32			height;
+	BString			pix_fmt;
+	BString			field_order;
+	BString			r_frame_rate;
+	int64			nb_frames;
+
+	// audio
+	int32			sample_rate;
+	int32			channels;
+	BString			channel_layout;
+
+	int64			bit_rate;
+	double			duration;
+};
+
+
+struct MediaInfo {
+					MediaInfo();
+
+	void			MakeEmpty();
+	status_t		Archive(BMessage* archive) const;
+	status_t		Unarchive(const BMessage* archive);
+
+	// The first stream of a codec_type ("video", "audio", ...) or NULL
+	const StreamInfo*	FirstStream(const char* type) const;
+
+	std::vector<StreamInfo> streams;
+	BString			format_name;
+	int64			bit_rate;
+	double			duration;
+};
+
+
+// Reads the output of "ffprobe -show_streams -show_format -of json" as it
+// comes in. Only the values of the streams and format objects are kept,
+// everything nested deeper (tags, disposition) is skipped.
+class MediaInfoParser {
+public:
+					MediaInfoParser();
+
+	void			Reset();
+	void			Feed(const char* data, size_t length);
+
+	bool			IsValid() const { return !fError && fDepth == 0 && fStarted; }
+	const MediaInfo&	Info() const { return fInfo; }
+
+private:
+	enum {
+		kMaxDepth = 16
+	};
+
+	enum state {
+		VALUE,			// expecting a value (or a key in an object)
+		STRING,
+		STRING_ESCAPE,
+		STRING_UNICODE,
+		LITERAL			// number, true, false or null
+	};
+
+	void			_Push(bool object);
+	void			_Pop();
+	void			_Scalar(const BString& value, bool isString);
+	void			_SetStreamValue(StreamInfo& stream, const BString& key,
+						const BString& value);
+	void			_SetFormatValue(const BString& key, const BString& value);
+
+	MediaInfo		fInfo;
+
+	state			fState;
+	BString			fToken;
+	uint32			fUnicode;
+	int32			fUnicodeDigits;
+
+	// containers we're in, and the current key of objects
+	bool			fIsObject[kMaxDepth];
+	BString			fKey[kMaxDepth];
+	bool			fExpectKey;
+	int32			fDepth;
+	bool			fStarted;
+	bool			fError;
+};
+
+
+#endif // MEDIAINFO_H
@@ -22,6 +22,7 @@ enum {
 	M_PLAY_OUTPUT,
 	M_RESET_CROPPING,
 	M_NEW_PREVIEW,
+	M_AUTO_CROP,
 };
 // Spinners
 enum {
@@ -56,7 +57,8 @@ enum {
 // Text Controls
 enum {
 	 M_SOURCEFILE = 1500,
-	 M_OUTPUTFILE
+	 M_OUTPUTFILE,
+	 M_SOURCEFILE_SETTLED
 };
 // File Panels
 enum {
@@ -73,7 +75,22 @@ enum {
 	 M_INFO_FINISHED,
 	 M_STOP_COMMAND,
 	 M_EXTRACTIMAGE_COMMAND,
-	 M_EXTRACTIMAGE_FINISHED
+	 M_EXTRACTIMAGE_FINISHED,
+	 M_BATCH_PROBE,
+	 M_BATCH_PROBED,
+	 M_PREVIEW_SOURCE,
+	 M_PREVIEW_REQUEST,
+	 M_PREVIEW_FRAME,
+	 M_CROP_DETECT,
+	 M_CROP_DETECTED,
+	 M_CROP_TIMEOUT,
+	 M_NEXT_COMMAND,
+	 M_PAUSE_COMMAND,
+	 M_RESUME_COMMAND,
+	 M_CHILD_OUTPUT,
+	 M_CHILD_EXITED,
+	 M_FLUSH_OUTPUT,
+	 M_KILL_TIMEOUT
 };
 // Misc
 enum {
@@ -89,6 +106,9 @@ enum {
 	 M_DEFAULTS,
 	 M_HELP,
 	 M_WEBSITE,
+	 M_SEGMENTED_ENCODING,
+	 M_SHELL_COMMANDLINE,
+	 M_PAUSE_ENCODING,
 };
 // Job window
 enum {
@@ -107,6 +127,15 @@ enum {
 	 M_LIST_DOWN,
 	 M_CLOSE,
 	 M_CONTEXT_CLOSE,
+	 M_JOB_CONCURRENCY,
+	 M_JOB_PAUSE,
+	 M_JOB_RESUME,
+	 M_JOURNAL_SYNC,
+	 M_JOBS_RESTORED,
+	 M_JOB_POLICY,
+	 M_JOB_PRIORITY,
+	 M_JOB_DEADLINE,
+	 M_JOB_RESUMABLE,
 };
 
 #endif // MESSAGES_H
@@ -0,0 +1,216 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+
+
+#include "PreviewPool.h"
+#include "CommandLauncher.h"
+#include "Messages.h"
+#include "Utilities.h"
+
+#include <Bitmap.h>
+#include <OS.h>
+
+#include <algorithm>
+
+
+// Frames are kept at the size of the source, so their number is bounded
+// by the memory they take
+static const int32 kMaxFrames = 4;
+static const int64 kMaxMemory = 48 * 1024 * 1024;
+static const int32 kSlotCount = 16;
+
+// Give up on a source after that many extractions in a row failed
+static const int32 kMaxFailures = 3;
+
+
+PreviewPool::PreviewPool(BMessenger* target_messenger)
+	:
+	BLooper("PreviewPool"),
+	fTargetMessenger(target_messenger),
+	fExtracting(false),
+	fDuration(0),
+	fWidth(0),
+	fHeight(0),
+	fGeneration(0),
+	fCapacity(0),
+	fFailures(0),
+	fRequestPending(false),
+	fRequestTime(0),
+	fSlotCount(0),
+	fRandom(system_time())
+{
+	fLauncher = new CommandLauncher(new BMessenger(this));
+	Run();
+}
+
+
+PreviewPool::~PreviewPool()
+{
+	_DeleteFrames();
+}
+
+
+void
+PreviewPool::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case M_PREVIEW_SOURCE:
+		{
+			_DeleteFrames();
+			fGeneration++;
+			if (fExtracting)
+				fLauncher->PostMessage(M_STOP_COMMAND);
+
+			fSource = message->GetString("path", "");
+			fDuration = message->GetInt32("duration", 0);
+			fWidth = message->GetInt32("width", 0);
+			fHeight = message->GetInt32("height", 0);
+			fFailures = 0;
+			fRequestPending = false;
+			fSlots.clear();
+
+			int64 frame_size = (int64)fWidth * fHeight * 4;
+			fCapacity = 0;
+			if (frame_size > 0)
+				fCapacity = std::max((int64)1, std::min((int64)kMaxFrames, kMaxMemory / frame_size));
+
+			_Refill();
+			break;
+		}
+		case M_PREVIEW_REQUEST:
+		{
+			if (!fFrames.empty()) {
+				BBitmap* frame = fFrames.front();
+				fFrames.pop_front();
+				fRequestTime = system_time();
+				_SendFrame(frame);
+			} else if (fCapacity == 0 || fFailures >= kMaxFailures) {
+				fRequestTime = system_time();
+				_SendFrame(NULL);
+			} else {
+				fRequestPending = true;
+				fRequestTime = system_time();
+			}
+
+			_Refill();
+			break;
+		}
+		case M_EXTRACTIMAGE_FINISHED:
+		{
+			fExtracting = false;
+
+			BBitmap* frame = NULL;
+			message->FindPointer("bitmap", (void**)&frame);
+
+			// a frame of a previous source
+			if (message->GetInt32("id", -1) != fGeneration) {
+				delete frame;
+				_Refill();
+				break;
+			}
+
+			if (frame == NULL) {
+				fFailures++;
+				if (fRequestPending && fFailures >= kMaxFailures)
+					_SendFrame(NULL);
+			} else {
+				fFailures = 0;
+				if (fRequestPending)
+					_SendFrame(frame);
+				else
+					fFrames.push_back(frame);
+			}
+
+			_Refill();
+			break;
+		}
+		default:
+			BLooper::MessageReceived(message);
+	}
+}
+
+
+void
+PreviewPool::_Refill()
+{
+	if (fExtracting || fSource.IsEmpty() || fFailures >= kMaxFailures
+		|| (int32)fFrames.size() >= fCapacity)
+		return;
+
+	char time[64];
+	seconds_to_string(_NextSecond(), time, sizeof(time));
+
+	// Decode the frame to raw pixels on stdout, which the launcher reads
+	// straight into a bitmap. bgra is the byte order of B_RGB32.
+	// Filling the pool shouldn't get in the way of anything else, so it's
+	// done with a single thread at low priority.
+	BString input_options, output_options;
+	input_options << kFFMpeg << " -v error -threads 1 -ss " << time << " -i";
+	output_options << "-frames:v 1 -s " << fWidth << "x" << fHeight
+		<< " -f rawvideo -pix_fmt bgra pipe:1";
+
+	// the file name goes in as it is, without any quoting
+	BStringList arguments, output_arguments;
+	tokenize_commandline(input_options, arguments);
+	arguments.Add(fSource);
+	tokenize_commandline(output_options, output_arguments);
+	arguments.Add(output_arguments);
+
+	BMessage extract(M_EXTRACTIMAGE_COMMAND);
+	extract.AddStrings("argv", arguments);
+	extract.AddInt32("id", fGeneration);
+	extract.AddInt32("width", fWidth);
+	extract.AddInt32("height", fHeight);
+	extract.AddInt32("priority", B_LOW_PRIORITY);
+	fLauncher->PostMessage(&extract);
+	fExtracting = true;
+}
+
+
+void
+PreviewPool::_SendFrame(BBitmap* frame)
+{
+	BMessage reply(M_PREVIEW_FRAME);
+	if (frame != NULL)
+		reply.AddPointer("bitmap", frame);
+	reply.AddInt64("elapsed", system_time() - fRequestTime);
+	fTargetMessenger->SendMessage(&reply);
+	fRequestPending = false;
+}
+
+
+void
+PreviewPool::_DeleteFrames()
+{
+	for (BBitmap* frame : fFrames)
+		delete frame;
+	fFrames.clear();
+}
+
+
+int32
+PreviewPool::_NextSecond()
+{
+	// skip first and last second of the clip (often black)
+	int32 first = 1;
+	int32 last = fDuration - 1;
+	if (last < first)
+		return 0;
+
+	if (fSlots.empty()) {
+		fSlotCount = std::min(last - first + 1, kSlotCount);
+		for (int32 i = 0; i < fSlotCount; i++)
+			fSlots.push_back(i);
+		std::shuffle(fSlots.begin(), fSlots.end(), fRandom);
+	}
+
+	int32 slot = fSlots.back();
+	fSlots.pop_back();
+
+	int32 span = last - first + 1;
+	int32 begin = first + (int64)span * slot / fSlotCount;
+	int32 end = first + (int64)span * (slot + 1) / fSlotCount;
+	return begin + fRandom() % (end - begin);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+#ifndef PREVIEWPOOL_H
+#define PREVIEWPOOL_H
+
+
+#include <Looper.h>
+#include <Messenger.h>
+#include <String.h>
+
+#include <deque>
+#include <random>
+#include <vector>
+
+class BBitmap;
+class CommandLauncher;
+
+
+// Keeps a few preview frames of the current source at hand, extracted in
+// the background at random points spread over the whole duration.
+// M_PREVIEW_SOURCE sets the "path", "duration" (seconds), "width" and
+// "height" of a new source and drops the frames of the old one.
+// M_PREVIEW_REQUEST is answered with an M_PREVIEW_FRAME carrying a
+// "bitmap" the target takes ownership of, immediately if a frame is ready,
+// otherwise as soon as one is. "elapsed" is the time the target had to
+// wait. If no frame could be extracted, the "bitmap" is missing.
+class PreviewPool : public BLooper {
+public:
+					PreviewPool(BMessenger* target_messenger);
+					~PreviewPool();
+
+	void 			MessageReceived(BMessage* message);
+
+private:
+	void			_Refill();
+	void			_SendFrame(BBitmap* frame);
+	void			_DeleteFrames();
+	int32			_NextSecond();
+
+	BMessenger* 	fTargetMessenger;
+	CommandLauncher* fLauncher;
+	bool			fExtracting;
+
+	BString			fSource;
+	int32			fDuration;
+	int32			fWidth;
+	int32			fHeight;
+	int32			fGeneration;
+	int32			fCapacity;
+	int32			fFailures;
+
+	std::deque<BBitmap*> fFrames;
+	bool			fRequestPending;
+	bigtime_t		fRequestTime;
+
+	// the duration is split into slots that are visited in random order,
+	// so no second is shown twice before all slots had their turn
+	std::vector<int32> fSlots;
+	int32			fSlotCount;
+	std::mt19937	fRandom;
+};
+
+
+#endif // PREVIEWPOOL_H
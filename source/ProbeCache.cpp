@@ -0,0 +1,212 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+
+
+#include "ProbeCache.h"
+
+#include <Autolock.h>
+#include <Entry.h>
+#include <File.h>
+#include <FindDirectory.h>
+#include <Path.h>
+
+
+static const size_t kMaxEntries = 1000;
+
+
+ProbeCache::ProbeCache()
+	:
+	fLock("probe cache"),
+	fDirty(false),
+	fHits(0),
+	fMisses(0)
+{
+}
+
+
+ProbeCache::~ProbeCache()
+{
+}
+
+
+bool
+ProbeCache::Lookup(const char* path, MediaInfo& info)
+{
+	struct stat stat;
+	if (!_Stat(path, stat))
+		return false;
+
+	BAutolock _(fLock);
+
+	EntryMap::iterator found = fIndex.find(path);
+	if (found == fIndex.end()) {
+		fMisses++;
+		return false;
+	}
+
+	// The file was changed or replaced since it was probed
+	Entry& entry = *found->second;
+	if (entry.inode != stat.st_ino || entry.size != stat.st_size
+		|| entry.mtime != stat.st_mtime) {
+		_Remove(found);
+		fMisses++;
+		return false;
+	}
+
+	fEntries.splice(fEntries.begin(), fEntries, found->second);
+	info = entry.info;
+	fHits++;
+	return true;
+}
+
+
+void
+ProbeCache::Store(const char* path, const MediaInfo& info)
+{
+	struct stat stat;
+	if (!_Stat(path, stat))
+		return;
+
+	BAutolock _(fLock);
+
+	EntryMap::iterator found = fIndex.find(path);
+	if (found != fIndex.end())
+		_Remove(found);
+
+	Entry entry;
+	entry.path = path;
+	entry.inode = stat.st_ino;
+	entry.size = stat.st_size;
+	entry.mtime = stat.st_mtime;
+	entry.info = info;
+	fEntries.push_front(entry);
+	fIndex[entry.path] = fEntries.begin();
+	fDirty = true;
+
+	_Trim();
+}
+
+
+status_t
+ProbeCache::Load()
+{
+	BPath path;
+	status_t status = _CachePath(path);
+	if (status != B_OK)
+		return status;
+
+	BFile file(path.Path(), B_READ_ONLY);
+	BMessage archive;
+	status = archive.Unflatten(&file);
+	if (status != B_OK)
+		return status;
+
+	BAutolock _(fLock);
+
+	BMessage entryArchive;
+	for (int32 i = 0; archive.FindMessage("entry", i, &entryArchive) == B_OK; i++) {
+		BMessage infoArchive;
+		Entry entry;
+		entry.path = entryArchive.GetString("path", "");
+		entry.inode = entryArchive.GetInt64("inode", -1);
+		entry.size = entryArchive.GetInt64("size", -1);
+		entry.mtime = entryArchive.GetInt64("mtime", -1);
+		if (entry.path.IsEmpty() || fIndex.find(entry.path) != fIndex.end()
+			|| entryArchive.FindMessage("info", &infoArchive) != B_OK)
+			continue;
+
+		entry.info.Unarchive(&infoArchive);
+		fEntries.push_back(entry);
+		fIndex[entry.path] = --fEntries.end();
+	}
+	_Trim();
+	fDirty = false;
+
+	return B_OK;
+}
+
+
+status_t
+ProbeCache::Save()
+{
+	BAutolock _(fLock);
+
+	if (!fDirty)
+		return B_OK;
+
+	BPath path;
+	status_t status = _CachePath(path);
+	if (status != B_OK)
+		return status;
+
+	BMessage archive;
+	for (EntryList::iterator it = fEntries.begin(); it != fEntries.end(); it++) {
+		BMessage entryArchive;
+		BMessage infoArchive;
+		it->info.Archive(&infoArchive);
+		entryArchive.AddString("path", it->path);
+		entryArchive.AddInt64("inode", it->inode);
+		entryArchive.AddInt64("size", it->size);
+		entryArchive.AddInt64("mtime", it->mtime);
+		entryArchive.AddMessage("info", &infoArchive);
+		archive.AddMessage("entry", &entryArchive);
+	}
+
+	BFile file(path.Path(), B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	status = file.InitCheck();
+	if (status == B_OK)
+		status = archive.Flatten(&file);
+	if (status == B_OK)
+		fDirty = false;
+
+	return status;
+}
+
+
+bool
+ProbeCache::_Stat(const char* path, struct stat& stat)
+{
+	BEntry entry(path, true);
+	return entry.GetStat(&stat) == B_OK && S_ISREG(stat.st_mode);
+}
+
+
+void
+ProbeCache::_Remove(EntryMap::iterator found)
+{
+	fEntries.erase(found->second);
+	fIndex.erase(found);
+	fDirty = true;
+}
+
+
+void
+ProbeCache::_Trim()
+{
+	while (fEntries.size() > kMaxEntries) {
+		fIndex.erase(fEntries.back().path);
+		fEntries.pop_back();
+		fDirty = true;
+	}
+}
+
+
+status_t
+ProbeCache::_CachePath(BPath& path)
+{
+	status_t status = find_directory(B_USER_SETTINGS_DIRECTORY, &path);
+	if (status != B_OK)
+		return status;
+
+	status = path.Append("ffmpegGUI");
+	if (status != B_OK)
+		return status;
+
+	status = create_directory(path.Path(), 0777);
+	if (status != B_OK)
+		return status;
+
+	return path.Append("probe_cache");
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+#ifndef PROBECACHE_H
+#define PROBECACHE_H
+
+
+#include "MediaInfo.h"
+
+#include <Locker.h>
+#include <String.h>
+
+#include <list>
+#include <map>
+#include <sys/stat.h>
+
+
+// Media info of probed files, kept in the settings folder across sessions.
+// Entries are found by path and only used as long as the file has the same
+// inode, size and modification time. The least recently used entries are
+// dropped when there are too many.
+// All methods lock, so the cache can be used from any window.
+class ProbeCache {
+public:
+					ProbeCache();
+					~ProbeCache();
+
+	bool			Lookup(const char* path, MediaInfo& info);
+	void			Store(const char* path, const MediaInfo& info);
+
+	status_t		Load();
+	status_t		Save();
+
+	// Misses are lookups of existing files that weren't in the cache
+	int32			Hits() const { return fHits; }
+	int32			Misses() const { return fMisses; }
+	int32			CountEntries() const { return fEntries.size(); }
+
+private:
+	struct Entry {
+		BString		path;
+		ino_t		inode;
+		off_t		size;
+		time_t		mtime;
+		MediaInfo	info;
+	};
+
+	typedef std::list<Entry> EntryList;
+	typedef std::map<BString, EntryList::iterator> EntryMap;
+
+	bool			_Stat(const char* path, struct stat& stat);
+	void			_Remove(EntryMap::iterator found);
+	void			_Trim();
+	status_t		_CachePath(BPath& path);
+
+	BLocker			fLock;
+	// most recently used first
+	EntryList		fEntries;
+	EntryMap		fIndex;
+	bool			fDirty;
+
+	int32			fHits;
+	int32			fMisses;
+};
+
+
+#endif // PROBECACHE_H
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+
+
+#include "ProbePool.h"
+#include "CommandLauncher.h"
+#include "Messages.h"
+#include "ProbeCache.h"
+#include "Utilities.h"
+
+#include <OS.h>
+
+
+ProbePool::ProbePool(BMessenger* target_messenger, ProbeCache* cache, int32 workers)
+	:
+	BLooper("ProbePool"),
+	fTargetMessenger(target_messenger),
+	fCache(cache),
+	fRunning(0)
+{
+	if (workers <= 0) {
+		system_info info;
+		get_system_info(&info);
+		workers = info.cpu_count;
+	}
+
+	fPaths.resize(workers);
+	fParsers.resize(workers);
+	for (int32 i = 0; i < workers; i++)
+		fWorkers.push_back(new CommandLauncher(new BMessenger(this)));
+
+	Run();
+}
+
+
+void
+ProbePool::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case M_BATCH_PROBE:
+		{
+			BString path;
+			for (int32 i = 0; message->FindString("path", i, &path) == B_OK; i++)
+				fQueue.push_back(path);
+
+			_Dispatch();
+			break;
+		}
+		case M_INFO_OUTPUT:
+		{
+			int32 worker = message->GetInt32("id", -1);
+			BString data;
+			if (worker < 0 || worker >= (int32)fWorkers.size()
+				|| message->FindString("data", &data) != B_OK)
+				break;
+
+			fParsers[worker].Feed(data.String(), data.Length());
+			break;
+		}
+		case M_INFO_FINISHED:
+		{
+			int32 worker = message->GetInt32("id", -1);
+			if (worker < 0 || worker >= (int32)fWorkers.size())
+				break;
+
+			BString path(fPaths[worker]);
+			fPaths[worker] = "";
+			fRunning--;
+
+			const MediaInfoParser& parser = fParsers[worker];
+			if (message->GetInt32("exitcode", FAILED) == SUCCESS && parser.IsValid()
+				&& !parser.Info().streams.empty()) {
+				fCache->Store(path, parser.Info());
+				_SendResult(path, &parser.Info(), message->GetInt64("spawn_time", 0));
+			} else
+				_SendResult(path, NULL, message->GetInt64("spawn_time", 0));
+
+			_Dispatch();
+			break;
+		}
+		default:
+			BLooper::MessageReceived(message);
+	}
+}
+
+
+void
+ProbePool::_Dispatch()
+{
+	while (!fQueue.empty()) {
+		BString path(fQueue.front());
+
+		// Files probed before don't need a worker
+		MediaInfo info;
+		if (fCache->Lookup(path, info)) {
+			fQueue.pop_front();
+			_SendResult(path, &info, -1);
+			continue;
+		}
+
+		int32 worker = -1;
+		for (size_t i = 0; i < fPaths.size(); i++) {
+			if (fPaths[i].IsEmpty()) {
+				worker = i;
+				break;
+			}
+		}
+		if (worker < 0)
+			return;
+
+		fQueue.pop_front();
+		fPaths[worker] = path;
+		fParsers[worker].Reset();
+		fRunning++;
+
+		BString command;
+		command << kFFProbe << " -v error -show_streams -show_format -of json";
+		BStringList arguments;
+		tokenize_commandline(command, arguments);
+		arguments.Add(path);
+
+		BMessage probe(M_INFO_COMMAND);
+		probe.AddStrings("argv", arguments);
+		probe.AddInt32("id", worker);
+		fWorkers[worker]->PostMessage(&probe);
+	}
+}
+
+
+void
+ProbePool::_SendResult(const BString& path, const MediaInfo* info, bigtime_t spawn_time)
+{
+	BMessage result(M_BATCH_PROBED);
+	result.AddString("path", path);
+	if (spawn_time >= 0)
+		result.AddInt64("spawn_time", spawn_time);
+	result.AddInt32("pending", fQueue.size() + fRunning);
+
+	if (info != NULL) {
+		BMessage archive;
+		info->Archive(&archive);
+		result.AddMessage("info", &archive);
+	}
+	fTargetMessenger->SendMessage(&result);
+}
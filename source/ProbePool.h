@@ -0,0 +1,53 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+#ifndef PROBEPOOL_H
+#define PROBEPOOL_H
+
+
+#include "MediaInfo.h"
+
+#include <Looper.h>
+#include <Messenger.h>
+#include <String.h>
+
+#include <deque>
+#include <vector>
+
+class CommandLauncher;
+class ProbeCache;
+
+
+// Probes many files at once, with up to one ffprobe per CPU core.
+// M_BATCH_PROBE queues the "path" strings of a message. Every file is
+// answered with its own M_BATCH_PROBED as soon as it's done, carrying the
+// "path", the archived MediaInfo as "info" (if the probe worked) and the
+// number of files still "pending". Files that had to be probed also have
+// the time it took to start ffprobe as "spawn_time".
+class ProbePool : public BLooper {
+public:
+					ProbePool(BMessenger* target_messenger, ProbeCache* cache,
+						int32 workers = 0);
+
+	void 			MessageReceived(BMessage* message);
+
+private:
+	void			_Dispatch();
+	void			_SendResult(const BString& path, const MediaInfo* info,
+						bigtime_t spawn_time);
+
+	BMessenger* 	fTargetMessenger;
+	ProbeCache*		fCache;
+
+	std::deque<BString> fQueue;
+
+	// one entry per worker, an empty path means the worker is idle
+	std::vector<CommandLauncher*> fWorkers;
+	std::vector<BString> fPaths;
+	std::vector<MediaInfoParser> fParsers;
+	int32			fRunning;
+};
+
+
+#endif // PROBEPOOL_H
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+
+
+#include "ProgressParser.h"
+
+#include <cstdlib>
+#include <cstring>
+
+
+static bool
+key_is(const char* line, size_t keyLength, const char* key)
+{
+	return strlen(key) == keyLength && memcmp(line, key, keyLength) == 0;
+}
+
+
+static int64
+parse_int(const char* value, const char* end)
+{
+	while (value < end && *value == ' ')
+		value++;
+	if (value == end || *value < '0' || *value > '9')
+		return -1;
+
+	int64 result = 0;
+	for (; value < end && *value >= '0' && *value <= '9'; value++)
+		result = result * 10 + (*value - '0');
+	return result;
+}
+
+
+static float
+parse_float(const char* value, const char* end)
+{
+	while (value < end && *value == ' ')
+		value++;
+	if (value == end || ((*value < '0' || *value > '9') && *value != '-'))
+		return -1;
+
+	// The value is always followed by a newline or the terminated rest
+	// buffer, so strtod() doesn't run past the line
+	return strtod(value, NULL);
+}
+
+
+ProgressParser::ProgressParser()
+{
+	Reset();
+}
+
+
+void
+ProgressParser::Reset()
+{
+	fRestLength = 0;
+	_ClearBlock();
+	fInfo = fBlock;
+}
+
+
+int32
+ProgressParser::Feed(const char* data, size_t length)
+{
+	int32 blocks = 0;
+	const char* end = data + length;
+
+	// complete the line left over from the last call
+	if (fRestLength > 0) {
+		const char* newline = (const char*)memchr(data, '\n', length);
+		size_t count = (newline != NULL ? newline : end) - data;
+		if (fRestLength + count >= sizeof(fRest))
+			count = sizeof(fRest) - fRestLength - 1;	// overlong: truncate
+		memcpy(fRest + fRestLength, data, count);
+		fRestLength += count;
+		fRest[fRestLength] = '\0';
+
+		if (newline == NULL)
+			return 0;
+
+		if (_ParseLine(fRest, fRestLength))
+			blocks++;
+		fRestLength = 0;
+		data = newline + 1;
+	}
+
+	while (data < end) {
+		const char* newline = (const char*)memchr(data, '\n', end - data);
+		if (newline == NULL) {
+			size_t count = end - data;
+			if (count >= sizeof(fRest))
+				count = sizeof(fRest) - 1;
+			memcpy(fRest, data, count);
+			fRestLength = count;
+			fRest[fRestLength] = '\0';
+			break;
+		}
+
+		if (_ParseLine(data, newline - data))
+			blocks++;
+		data = newline + 1;
+	}
+
+	return blocks;
+}
+
+
+bool
+ProgressParser::_ParseLine(const char* line, size_t length)
+{
+	if (length > 0 && line[length - 1] == '\r')
+		length--;
+
+	const char* equal = (const char*)memchr(line, '=', length);
+	if (equal == NULL)
+		return false;
+
+	size_t keyLength = equal - line;
+	const char* value = equal + 1;
+	const char* end = line + length;
+
+	// "out_time_ms" is in microseconds as well, it's only there for older
+	// versions of ffmpeg that don't report "out_time_us"
+	if (key_is(line, keyLength, "out_time_us")
+		|| (key_is(line, keyLength, "out_time_ms") && fBlock.time_us < 0))
+		fBlock.time_us = parse_int(value, end);
+	else if (key_is(line, keyLength, "frame"))
+		fBlock.frame = parse_int(value, end);
+	else if (key_is(line, keyLength, "fps"))
+		fBlock.fps = parse_float(value, end);
+	else if (key_is(line, keyLength, "bitrate"))
+		fBlock.bitrate = parse_float(value, end);
+	else if (key_is(line, keyLength, "total_size"))
+		fBlock.total_size = parse_int(value, end);
+	else if (key_is(line, keyLength, "speed"))
+		fBlock.speed = parse_float(value, end);
+	else if (key_is(line, keyLength, "progress")) {
+		// "progress=continue" or "progress=end" closes a block
+		fBlock.finished = (end - value == 3) && memcmp(value, "end", 3) == 0;
+		fInfo = fBlock;
+		_ClearBlock();
+		return true;
+	}
+
+	return false;
+}
+
+
+void
+ProgressParser::_ClearBlock()
+{
+	fBlock.time_us = -1;
+	fBlock.frame = -1;
+	fBlock.fps = -1;
+	fBlock.bitrate = -1;
+	fBlock.total_size = -1;
+	fBlock.speed = -1;
+	fBlock.finished = false;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+#ifndef PROGRESSPARSER_H
+#define PROGRESSPARSER_H
+
+
+#include <SupportDefs.h>
+
+
+// One block of ffmpeg's "-progress" output. Values ffmpeg reports as
+// "N/A" are -1.
+struct ProgressInfo {
+	bigtime_t		time_us;
+	int64			frame;
+	float			fps;
+	float			bitrate;	// kbit/s
+	int64			total_size;	// bytes
+	float			speed;
+	bool			finished;
+};
+
+
+// Incrementally parses the key=value lines of "ffmpeg -progress". Lines are
+// read straight out of the buffers passed to Feed(), only a line cut off at
+// the end of a buffer is kept until the next call.
+class ProgressParser {
+public:
+					ProgressParser();
+
+	void			Reset();
+
+	// Returns the number of blocks completed by this data, the last one
+	// is available from Info()
+	int32			Feed(const char* data, size_t length);
+	const ProgressInfo&	Info() const { return fInfo; }
+
+private:
+	bool			_ParseLine(const char* line, size_t length);
+	void			_ClearBlock();
+
+	ProgressInfo	fBlock;
+	ProgressInfo	fInfo;
+
+	char			fRest[128];
+	size_t			fRestLength;
+};
+
+
+#endif // PROGRESSPARSER_H
@@ -0,0 +1,1013 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+
+
+#include "SegmentEncoder.h"
+#include "CommandLauncher.h"
+#include "ErrorMatcher.h"
+#include "Messages.h"
+#include "Utilities.h"
+
+#include <Directory.h>
+#include <Entry.h>
+#include <File.h>
+#include <FindDirectory.h>
+#include <OS.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdio.h>
+
+
+// Segments shorter than this aren't worth an extra ffmpeg process
+static const int32 kMinSegmentSeconds = 20;
+// How far after a wanted split point we look for a keyframe
+static const int32 kKeyframeSearchSeconds = 10;
+// Length of the segments of a checkpointed encode, that's about how much
+// is lost when it's interrupted
+static const int32 kCheckpointSeconds = 60;
+
+// Options that only apply to the video or audio, each followed by a value
+static const char* kVideoOptions[] = { "-vcodec", "-r", "-s", "-vf",
+	"-aspect", "-pix_fmt", "-crf", "-qp", "-preset", "-tune", "-profile",
+	"-level", "-g", "-keyint_min", "-bf", "-maxrate", "-minrate", "-bufsize",
+	"-qmin", "-qmax", "-deadline", "-cpu-used", "-row-mt", "-tile-columns",
+	"-x264-params", "-x265-params", "-vtag", NULL };
+static const char* kAudioOptions[] = { "-acodec", "-ar", "-ac", "-af",
+	"-aq", "-sample_fmt", "-channel_layout", NULL };
+// Options that can be given for one kind of stream, like "-c:v"
+static const char* kStreamOptions[] = { "-c", "-codec", "-b", "-q", "-qscale",
+	"-filter", "-profile", "-level", "-tag", "-pix_fmt", "-r", "-s", "-aspect",
+	"-ar", "-ac", "-crf", "-preset", "-tune", "-g", "-maxrate", "-minrate",
+	"-bufsize", NULL };
+// Options that go to every encode, with and without a value
+static const char* kGlobalOptions[] = { "-strict", "-loglevel", "-v",
+	"-threads", NULL };
+static const char* kGlobalFlags[] = { "-stats", "-nostats", "-hide_banner",
+	"-dn", NULL };
+// Input options that choose which part of the source is encoded
+static const char* kSeekOptions[] = { "-ss", "-t", "-to", "-sseof",
+	"-itsoffset", "-stream_loop", NULL };
+
+// IDs of the non-segment commands
+enum {
+	kKeyframeProbe = -1,
+	kAudioTrack = -2,
+	kJoin = -3,
+	kSingle = -4,
+	kStreamProbe = -5
+};
+
+// Encoder state
+enum {
+	IDLE = 0,
+	PROBING,
+	SEGMENTING,
+	JOINING,
+	SINGLE
+};
+
+
+static bool
+find_option(const char* options[], const BString& option)
+{
+	for (int32 i = 0; options[i] != NULL; i++) {
+		if (option == options[i])
+			return true;
+	}
+	return false;
+}
+
+
+static void
+remove_directory(const char* path)
+{
+	// The entries are collected first, removing them while reading the
+	// directory could skip some
+	BDirectory directory(path);
+	std::vector<BPath> entries;
+	BEntry entry;
+	while (directory.GetNextEntry(&entry) == B_OK)
+		entries.push_back(BPath(&entry));
+
+	for (const BPath& entryPath : entries) {
+		if (BEntry(entryPath.Path()).IsDirectory())
+			remove_directory(entryPath.Path());
+		else
+			BEntry(entryPath.Path()).Remove();
+	}
+	BEntry(path).Remove();
+}
+
+
+SegmentEncoder::SegmentEncoder(BMessenger* target_messenger)
+	:
+	BLooper("SegmentEncoder"),
+	fTargetMessenger(target_messenger),
+	fShell(false),
+	fHasAudio(false),
+	fNoSubtitles(false),
+	fSubtitlesFound(false),
+	fDuration(0),
+	fRunning(0),
+	fID(-1),
+	fCheckpoint(false),
+	fAudioDone(false),
+	fRecovered(0),
+	fUnitStart(0),
+	fState(IDLE),
+	fErrorCode(SUCCESS),
+	fError(ERROR_NONE),
+	fStartTime(0),
+	fStopTime(0),
+	fStoppedAt(-1),
+	fPauseStart(0),
+	fPausedTime(0),
+	fUpdateRate(kDefaultUpdateRate),
+	fUpdateCount(0),
+	fMessageCount(0)
+{
+	Run();
+}
+
+
+SegmentEncoder::~SegmentEncoder()
+{
+	// The launchers kill what they still run. Only a checkpointed encode
+	// keeps its segments, to be continued later.
+	for (size_t i = 0; i < fLaunchers.size(); i++) {
+		fLaunchers[i]->Lock();
+		fLaunchers[i]->Quit();
+	}
+	if (!fCheckpoint)
+		_Cleanup();
+}
+
+
+void
+SegmentEncoder::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case M_ENCODE_COMMAND:
+		{
+			if (fState != IDLE)
+				break;
+
+			fStartTime = system_time();
+			fErrorCode = SUCCESS;
+			fError = ERROR_NONE;
+			fStopTime = 0;
+			fStoppedAt = -1;
+			fPauseStart = 0;
+			fPausedTime = 0;
+			fUpdateCount = 0;
+			fMessageCount = 0;
+			fDuration = message->GetInt32("duration", 0);
+			fUpdateRate = message->GetInt32("update_rate", kDefaultUpdateRate);
+			message->FindString("cmdline", &fCommandline);
+			fShell = message->GetBool("shell", false);
+			fID = message->GetInt32("id", -1);
+			fRecovered = 0;
+
+			BString checkpoint;
+			fCheckpoint = message->FindString("checkpoint", &checkpoint) == B_OK;
+
+			// Without checkpoints, splitting only pays off with several cores
+			system_info info;
+			get_system_info(&info);
+			int32 minimum = fCheckpoint ? kCheckpointSeconds : kMinSegmentSeconds;
+
+			// A commandline for the shell can't be taken apart reliably
+			if (fShell || !_ParseCommandline(fCommandline)
+				|| (fDuration < 2 * minimum) || (!fCheckpoint && info.cpu_count < 2)) {
+				_StartSingle();
+				break;
+			}
+
+			if (fCheckpoint) {
+				fWorkDirectory.SetTo(checkpoint.String());
+				create_directory(fWorkDirectory.Path(), 0777);
+				if (_ReadJournal()) {
+					fState = SEGMENTING;
+					_StartNextCheckpoint();
+					break;
+				}
+			}
+
+			if (fNoSubtitles)
+				_ProbeKeyframes();
+			else
+				_ProbeStreams();
+			break;
+		}
+		case M_STOP_COMMAND:
+		{
+			if (fState == IDLE)
+				break;
+
+			if (fStopTime == 0)
+				fStopTime = system_time();
+			if (fPauseStart > 0) {
+				fPausedTime += system_time() - fPauseStart;
+				fPauseStart = 0;
+			}
+
+			// Only a single process can stop gracefully and leave playable
+			// output, segments would have to be joined first
+			if (fState == SINGLE) {
+				_LauncherAt(0)->PostMessage(message);
+				break;
+			}
+
+			_Abort(ABORTED);
+			break;
+		}
+		case M_PAUSE_COMMAND:
+		{
+			if (fState == IDLE || fPauseStart > 0)
+				break;
+
+			fPauseStart = system_time();
+			for (size_t i = 0; i < fLaunchers.size(); i++)
+				fLaunchers[i]->PostMessage(M_PAUSE_COMMAND);
+			break;
+		}
+		case M_RESUME_COMMAND:
+		{
+			if (fPauseStart == 0)
+				break;
+
+			fPausedTime += system_time() - fPauseStart;
+			fPauseStart = 0;
+			for (size_t i = 0; i < fLaunchers.size(); i++)
+				fLaunchers[i]->PostMessage(M_RESUME_COMMAND);
+			break;
+		}
+		case M_INFO_OUTPUT:
+		{
+			BString data;
+			if (message->FindString("data", &data) != B_OK)
+				break;
+
+			if (message->GetInt32("id", kKeyframeProbe) == kStreamProbe)
+				_ParseStreams(data.String());
+			else
+				_ParseKeyframes(data.String());
+			break;
+		}
+		case M_INFO_FINISHED:
+		{
+			fRunning--;
+			if (fErrorCode != SUCCESS) {
+				_Finish(fErrorCode);
+				break;
+			}
+
+			if (message->GetInt32("id", kKeyframeProbe) != kStreamProbe)
+				_StartSegments();
+			else if (fSubtitlesFound) {
+				// the segments only have video, the subtitles would be lost
+				_Cleanup();
+				_StartSingle();
+			} else
+				_ProbeKeyframes();
+			break;
+		}
+		case M_ENCODE_PROGRESS:
+		{
+			int32 id = message->GetInt32("id", kSingle);
+			if (id == kSingle) {
+				message->RemoveName("id");
+				if (fID >= 0)
+					message->AddInt32("id", fID);
+				fTargetMessenger->SendMessage(message);
+				fMessageCount++;
+				break;
+			}
+
+			BMessage progress(M_ENCODE_PROGRESS);
+			if (fID >= 0)
+				progress.AddInt32("id", fID);
+			BString data;
+			if (message->FindString("data", &data) == B_OK)
+				progress.AddString("data", data);
+
+			if ((id < 0) || (id >= (int32)fSegmentProgress.size())
+				|| !message->HasInt64("time_us")) {
+				if (!data.IsEmpty()) {
+					fTargetMessenger->SendMessage(&progress);
+					fMessageCount++;
+				}
+				break;
+			}
+
+			ProgressInfo& info = fSegmentProgress[id];
+			info.time_us = message->GetInt64("time_us", -1);
+			info.frame = message->GetInt64("frame", -1);
+			info.fps = message->GetFloat("fps", -1);
+			info.total_size = message->GetInt64("total_size", -1);
+			info.speed = message->GetFloat("speed", -1);
+
+			// progress of all segments is the sum of what they've encoded
+			ProgressInfo total = {};
+			for (size_t i = 0; i < fSegmentProgress.size(); i++) {
+				const ProgressInfo& segment = fSegmentProgress[i];
+				total.time_us += std::max(segment.time_us, (bigtime_t)0);
+				total.frame += std::max(segment.frame, (int64)0);
+				total.fps += std::max(segment.fps, 0.0f);
+				total.total_size += std::max(segment.total_size, (int64)0);
+				total.speed += std::max(segment.speed, 0.0f);
+			}
+			total.bitrate = (total.time_us > 0)
+				? total.total_size * 8000.0f / total.time_us : -1;
+
+			progress.AddInt64("time_us", total.time_us);
+			progress.AddInt64("frame", total.frame);
+			progress.AddFloat("fps", total.fps);
+			progress.AddFloat("bitrate", total.bitrate);
+			progress.AddInt64("total_size", total.total_size);
+			progress.AddFloat("speed", total.speed);
+			// the time left is estimated including the recovered segments
+			progress.AddInt64("active_us", _ActiveTime() + fRecovered);
+			if (fRecovered > 0)
+				progress.AddInt64("recovered_us", fRecovered);
+			fTargetMessenger->SendMessage(&progress);
+			fMessageCount++;
+			break;
+		}
+		case M_ENCODE_FINISHED:
+		{
+			int32 id = message->GetInt32("id", kSingle);
+			int32 exitcode = message->GetInt32("exitcode", FAILED);
+			fUpdateCount += message->GetInt32("updates", 0);
+			fRunning--;
+			if (fError == ERROR_NONE)
+				fError = message->GetInt32("error", ERROR_NONE);
+			fStoppedAt = message->GetInt64("time_us", -1);
+
+			if ((id == kSingle) || (id == kJoin)) {
+				_Finish(exitcode);
+				break;
+			}
+
+			// one segment (or the audio track) failed: stop all others
+			if ((exitcode == SUCCESS) && fCheckpoint)
+				_Checkpoint(id);
+			else if ((exitcode != SUCCESS) && (fErrorCode == SUCCESS))
+				_Abort(exitcode);
+
+			if (fRunning > 0)
+				break;
+
+			if (fErrorCode != SUCCESS)
+				_Finish(fErrorCode);
+			else if (fCheckpoint)
+				_StartNextCheckpoint();
+			else
+				_StartJoin();
+			break;
+		}
+		default:
+			BLooper::MessageReceived(message);
+	}
+}
+
+
+bool
+SegmentEncoder::_ParseCommandline(const BString& commandline)
+{
+	BStringList tokens;
+	tokenize_commandline(commandline, tokens);
+
+	fSource = fOutput = fFormat = "";
+	fInputOptions = fVideoOptions = fAudioOptions = "";
+	fHasAudio = true;
+	fNoSubtitles = false;
+
+	// "-y" is appended after the output file
+	int32 count = tokens.CountStrings();
+	while (count > 0 && tokens.StringAt(count - 1) == "-y")
+		count--;
+	if (count < 4)
+		return false;
+
+	// The output file is the last token, everything after the input file
+	// up to there are output options we sort into video and audio ones.
+	// Anything that could change which part of the source ends up in the
+	// output, or that we don't know where it belongs, can only be done by
+	// a single process. The parts are kept quoted for the shell, ready to
+	// be put into commands.
+	fOutput = quote_argument(tokens.StringAt(count - 1), true);
+	bool inputFound = false;
+	BString videoCodec;
+
+	for (int32 i = 1; i < count - 1; i++) {
+		BString token = tokens.StringAt(i);
+		bool hasValue = i + 1 < count - 1;
+		BString value = hasValue ? tokens.StringAt(i + 1) : "";
+
+		if (!inputFound) {
+			if (token == "-i") {
+				fSource = quote_argument(value, true);
+				inputFound = true;
+				i++;
+			} else if (find_option(kSeekOptions, token))
+				return false;
+			else
+				fInputOptions << quote_argument(token) << " ";
+			continue;
+		}
+
+		// an option for a kind of stream, like "-c:v" or "-b:a"
+		BString option(token);
+		char stream = 0;
+		int32 colon = token.FindFirst(':');
+		if (colon > 0) {
+			token.CopyInto(option, 0, colon);
+			stream = token.ByteAt(colon + 1);
+			if (!find_option(kStreamOptions, option)
+				|| (stream != 'v' && stream != 'a'))
+				return false;
+		} else if (find_option(kVideoOptions, token))
+			stream = 'v';
+		else if (find_option(kAudioOptions, token))
+			stream = 'a';
+
+		if (token == "-f" && hasValue) {
+			fFormat = quote_argument(value);
+			i++;
+		} else if (token == "-y") {
+			continue;
+		} else if (token == "-vn") {
+			return false;
+		} else if (token == "-an") {
+			fHasAudio = false;
+		} else if (token == "-sn") {
+			fNoSubtitles = true;
+		} else if (stream != 0 && hasValue) {
+			if (stream == 'v' && (option == "-vcodec" || option == "-c" || option == "-codec"))
+				videoCodec = value;
+			BString& options = (stream == 'v') ? fVideoOptions : fAudioOptions;
+			options << token << " " << quote_argument(value) << " ";
+			i++;
+		} else if (find_option(kGlobalOptions, token) && hasValue) {
+			fVideoOptions << token << " " << quote_argument(value) << " ";
+			fAudioOptions << token << " " << quote_argument(value) << " ";
+			i++;
+		} else if (find_option(kGlobalFlags, token)) {
+			fVideoOptions << token << " ";
+			fAudioOptions << token << " ";
+		} else
+			return false;
+	}
+
+	// Splitting makes no sense when the video stream is just copied
+	return inputFound && !fFormat.IsEmpty() && !videoCodec.IsEmpty() && videoCodec != "copy";
+}
+
+
+void
+SegmentEncoder::_StartSingle()
+{
+	// Not worth splitting: run the plain single-process encode
+	BMessage encode(M_ENCODE_COMMAND);
+	encode.AddString("cmdline", fCommandline);
+	encode.AddBool("shell", fShell);
+	encode.AddInt32("id", kSingle);
+	encode.AddInt32("update_rate", fUpdateRate);
+	_Post(0, &encode);
+	fBoundaries.clear();
+	fRunning = 1;
+	fState = SINGLE;
+}
+
+
+void
+SegmentEncoder::_ProbeStreams()
+{
+	// ffmpeg takes a subtitle stream over by default, the segments can't
+	fSubtitlesFound = false;
+	fProbeRest = "";
+
+	BString command;
+	command << kFFProbe << " -v error -show_entries stream=codec_type -of csv=p=0 "
+			<< fSource;
+
+	BMessage probe(M_INFO_COMMAND);
+	probe.AddString("cmdline", command);
+	probe.AddInt32("id", kStreamProbe);
+	_Post(0, &probe);
+	fRunning = 1;
+	fState = PROBING;
+}
+
+
+void
+SegmentEncoder::_ParseStreams(const char* data)
+{
+	// one line with the type of each stream, like "video" or "subtitle"
+	fProbeRest << data;
+	int32 start = 0;
+	int32 end;
+	while ((end = fProbeRest.FindFirst("\n", start)) >= 0) {
+		BString line;
+		fProbeRest.CopyInto(line, start, end - start);
+		start = end + 1;
+
+		if (line.Trim() == "subtitle")
+			fSubtitlesFound = true;
+	}
+	fProbeRest.Remove(0, start);
+}
+
+
+void
+SegmentEncoder::_ProbeKeyframes()
+{
+	int32 segments;
+	if (fCheckpoint)
+		segments = fDuration / kCheckpointSeconds;
+	else {
+		find_directory(B_SYSTEM_TEMP_DIRECTORY, &fWorkDirectory);
+		BString name;
+		name << "ffmpegGUI_segments_" << system_time();
+		fWorkDirectory.Append(name);
+		create_directory(fWorkDirectory.Path(), 0777);
+
+		system_info info;
+		get_system_info(&info);
+		segments = std::min((int32)info.cpu_count, fDuration / kMinSegmentSeconds);
+	}
+
+	// Only read the packets around the points where we'd like to split
+	BString intervals;
+	for (int32 i = 1; i < segments; i++) {
+		int32 target = i * fDuration / segments;
+		if (!intervals.IsEmpty())
+			intervals << ",";
+		intervals << target << "%+" << kKeyframeSearchSeconds;
+	}
+
+	fBoundaries.clear();
+	fBoundaries.push_back(0);
+	for (int32 i = 1; i < segments; i++)
+		fBoundaries.push_back(i * fDuration / segments);
+
+	fKeyframes.clear();
+	fProbeRest = "";
+
+	BString command;
+	command << kFFProbe << " -v error -select_streams v:0 "
+			<< "-show_entries packet=pts_time,flags -of csv=p=0 "
+			<< "-read_intervals \"" << intervals << "\" " << fSource;
+
+	BMessage probe(M_INFO_COMMAND);
+	probe.AddString("cmdline", command);
+	probe.AddInt32("id", kKeyframeProbe);
+	_Post(0, &probe);
+	fRunning = 1;
+	fState = PROBING;
+}
+
+
+void
+SegmentEncoder::_ParseKeyframes(const char* data)
+{
+	// lines look like "12.345000,K_", a keyframe has a "K" flag
+	fProbeRest << data;
+	int32 start = 0;
+	int32 end;
+	while ((end = fProbeRest.FindFirst("\n", start)) >= 0) {
+		BString line;
+		fProbeRest.CopyInto(line, start, end - start);
+		start = end + 1;
+
+		int32 comma = line.FindFirst(",");
+		if (comma <= 0 || line.ByteAt(comma + 1) != 'K')
+			continue;
+
+		BString time;
+		line.CopyInto(time, 0, comma);
+		if (time != "N/A")
+			fKeyframes.push_back(atof(time.String()));
+	}
+	fProbeRest.Remove(0, start);
+}
+
+
+void
+SegmentEncoder::_StartSegments()
+{
+	// Move each wanted split point to the nearest keyframe
+	std::sort(fKeyframes.begin(), fKeyframes.end());
+	std::vector<double> boundaries;
+	boundaries.push_back(0);
+
+	for (size_t i = 1; i < fBoundaries.size(); i++) {
+		double target = fBoundaries[i];
+		double best = -1;
+		for (size_t k = 0; k < fKeyframes.size(); k++) {
+			double keyframe = fKeyframes[k];
+			if ((keyframe <= boundaries.back() + 1) || (keyframe >= fDuration - 1))
+				continue;
+			if ((best < 0) || (fabs(keyframe - target) < fabs(best - target)))
+				best = keyframe;
+		}
+		if (best > 0)
+			boundaries.push_back(best);
+	}
+	fBoundaries = boundaries;
+
+	int32 segments = fBoundaries.size();
+	if (segments < 2) {
+		// No usable keyframes: fall back to the single-process encode
+		_Cleanup();
+		_StartSingle();
+		return;
+	}
+
+	ProgressInfo none = {};
+	fSegmentProgress.assign(segments, none);
+	fSegmentDone.assign(segments, false);
+	fAudioDone = false;
+	fRunning = 0;
+	fState = SEGMENTING;
+
+	if (fCheckpoint) {
+		// A new journal, the segments of an old one don't fit anymore
+		BEntry(_JournalPath().String()).Remove();
+		BString line;
+		line << "command " << fCommandline;
+		_WriteJournal(line);
+		line = "boundaries";
+		for (int32 i = 0; i < segments; i++)
+			line << " " << BString().SetToFormat("%.6f", fBoundaries[i]);
+		_WriteJournal(line);
+
+		_StartNextCheckpoint();
+		return;
+	}
+
+	for (int32 i = 0; i < segments; i++) {
+		// all segments together shouldn't send more updates than one encode
+		BMessage encode(M_ENCODE_COMMAND);
+		encode.AddString("cmdline", _SegmentCommand(i));
+		encode.AddInt32("id", i);
+		encode.AddInt32("update_rate", std::max((int32)1, fUpdateRate / segments));
+		_Post(i, &encode);
+		fRunning++;
+	}
+
+	if (fHasAudio) {
+		BMessage encode(M_ENCODE_COMMAND);
+		encode.AddString("cmdline", _AudioCommand());
+		encode.AddInt32("id", kAudioTrack);
+		_Post(segments, &encode);
+		fRunning++;
+	}
+}
+
+
+void
+SegmentEncoder::_StartNextCheckpoint()
+{
+	// One segment at a time, so the encode takes no more cores than a
+	// plain one
+	BMessage encode(M_ENCODE_COMMAND);
+	encode.AddInt32("update_rate", fUpdateRate);
+
+	int32 segment = 0;
+	while (segment < (int32)fSegmentDone.size() && fSegmentDone[segment])
+		segment++;
+
+	if (segment < (int32)fSegmentDone.size()) {
+		encode.AddString("cmdline", _SegmentCommand(segment));
+		encode.AddInt32("id", segment);
+	} else if (fHasAudio && !fAudioDone) {
+		encode.AddString("cmdline", _AudioCommand());
+		encode.AddInt32("id", kAudioTrack);
+	} else {
+		_StartJoin();
+		return;
+	}
+
+	fUnitStart = _ActiveTime();
+	_Post(0, &encode);
+	fRunning = 1;
+}
+
+
+void
+SegmentEncoder::_StartJoin()
+{
+	BPath listPath(fWorkDirectory);
+	listPath.Append("segments.txt");
+
+	BString list;
+	for (size_t i = 0; i < fBoundaries.size(); i++) {
+		BString path(_SegmentPath(i));
+		path.ReplaceAll("'", "'\\''");
+		list << "file '" << path << "'\n";
+	}
+
+	BFile file(listPath.Path(), B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	if (file.Write(list.String(), list.Length()) != list.Length()) {
+		_Finish(FAILED);
+		return;
+	}
+
+	BString command;
+	command << kFFMpeg << " -f concat -safe 0 -i " << quote_argument(listPath.Path(), true) << " ";
+	if (fHasAudio)
+		command << "-i " << quote_argument(_AudioPath(), true) << " -map 0:v -map 1:a ";
+	command << "-c copy -strict -2 -loglevel error -f " << fFormat << " -y " << fOutput;
+
+	BMessage encode(M_ENCODE_COMMAND);
+	encode.AddString("cmdline", command);
+	encode.AddInt32("id", kJoin);
+	_Post(0, &encode);
+	fRunning = 1;
+	fState = JOINING;
+}
+
+
+BString
+SegmentEncoder::_SegmentCommand(int32 segment)
+{
+	int32 segments = fBoundaries.size();
+	BString command;
+	command << kFFMpeg << " ";
+	if (segment > 0) {
+		BString start;
+		start.SetToFormat("-ss %.6f ", fBoundaries[segment]);
+		command << start;
+	}
+	command << fInputOptions << "-i " << fSource << " ";
+	if (segment < segments - 1) {
+		BString length;
+		length.SetToFormat("-t %.6f ", fBoundaries[segment + 1] - fBoundaries[segment]);
+		command << length;
+	}
+	command << fVideoOptions << "-an -f matroska -y "
+			<< quote_argument(_SegmentPath(segment), true);
+	return command;
+}
+
+
+BString
+SegmentEncoder::_AudioCommand()
+{
+	BString command;
+	command << kFFMpeg << " " << fInputOptions << "-i " << fSource << " -vn "
+			<< fAudioOptions << "-f matroska -y " << quote_argument(_AudioPath(), true);
+	return command;
+}
+
+
+void
+SegmentEncoder::_Finish(int32 exitcode)
+{
+	BMessage finished(M_ENCODE_FINISHED);
+	if (fID >= 0)
+		finished.AddInt32("id", fID);
+	finished.AddInt32("exitcode", exitcode);
+	if (exitcode == FAILED)
+		finished.AddInt32("error", fError);
+	if (fStopTime > 0)
+		finished.AddInt64("stop_latency", system_time() - fStopTime);
+	if (exitcode == STOPPED)
+		finished.AddInt64("time_us", fStoppedAt);
+	finished.AddInt64("elapsed", _ActiveTime());
+	finished.AddInt64("paused", fPausedTime);
+	if (fRecovered > 0)
+		finished.AddInt64("recovered_us", fRecovered);
+	finished.AddInt32("updates", fUpdateCount);
+	finished.AddInt32("messages", fMessageCount);
+	finished.AddInt32("segments", (fState == SINGLE) ? 1 : fBoundaries.size());
+	fTargetMessenger->SendMessage(&finished);
+
+	// the checkpoints are kept to continue the encode later
+	if (fCheckpoint && (exitcode != SUCCESS) && (fState != SINGLE))
+		fWorkDirectory.Unset();
+	else
+		_Cleanup();
+	fState = IDLE;
+}
+
+
+void
+SegmentEncoder::_Abort(int32 exitcode)
+{
+	fErrorCode = exitcode;
+	for (size_t i = 0; i < fLaunchers.size(); i++)
+		fLaunchers[i]->PostMessage(M_STOP_COMMAND);
+}
+
+
+void
+SegmentEncoder::_Cleanup()
+{
+	if (fWorkDirectory.InitCheck() != B_OK)
+		return;
+
+	RemoveCheckpoint(fWorkDirectory.Path());
+	fWorkDirectory.Unset();
+}
+
+
+void
+SegmentEncoder::RemoveCheckpoint(const char* directory)
+{
+	remove_directory(directory);
+}
+
+
+bool
+SegmentEncoder::_ReadJournal()
+{
+	// Lines are "command <commandline>", "boundaries <seconds>...", then
+	// "segment <index> <encode time>" or "audio <encode time>" for each
+	// finished one. A line cut short by a crash is just ignored.
+	BFile file(_JournalPath().String(), B_READ_ONLY);
+	off_t size;
+	if (file.InitCheck() != B_OK || file.GetSize(&size) != B_OK || size <= 0)
+		return false;
+
+	BString journal;
+	char* buffer = journal.LockBuffer(size);
+	ssize_t bytes = file.Read(buffer, size);
+	journal.UnlockBuffer(std::max(bytes, (ssize_t)0));
+
+	BStringList lines;
+	journal.Split("\n", true, lines);
+
+	bool matches = false;
+	fBoundaries.clear();
+	fSegmentDone.clear();
+	fAudioDone = false;
+	fRecovered = 0;
+
+	for (int32 i = 0; i < lines.CountStrings(); i++) {
+		BString line(lines.StringAt(i));
+		int32 space = line.FindFirst(' ');
+		if (space <= 0)
+			continue;
+
+		BString key, value;
+		line.CopyInto(key, 0, space);
+		line.CopyInto(value, space + 1, line.Length() - space - 1);
+
+		if (key == "command")
+			matches = (value == fCommandline);
+		else if (key == "boundaries") {
+			BStringList times;
+			value.Split(" ", true, times);
+			for (int32 t = 0; t < times.CountStrings(); t++)
+				fBoundaries.push_back(atof(times.StringAt(t).String()));
+
+			ProgressInfo none = {};
+			fSegmentProgress.assign(fBoundaries.size(), none);
+			fSegmentDone.assign(fBoundaries.size(), false);
+		} else if (key == "segment") {
+			int32 segment;
+			int64 elapsed;
+			if (sscanf(value.String(), "%" B_SCNd32 " %" B_SCNd64, &segment, &elapsed) != 2
+				|| segment < 0 || segment >= (int32)fSegmentDone.size()
+				|| !BEntry(_SegmentPath(segment).String()).Exists())
+				continue;
+
+			_SetSegmentDone(segment);
+			fRecovered += elapsed;
+		} else if (key == "audio") {
+			if (!BEntry(_AudioPath().String()).Exists())
+				continue;
+
+			fAudioDone = true;
+			fRecovered += atoll(value.String());
+		}
+	}
+
+	if (!matches || fBoundaries.size() < 2) {
+		fRecovered = 0;
+		return false;
+	}
+
+	return true;
+}
+
+
+void
+SegmentEncoder::_WriteJournal(const BString& line)
+{
+	// Each line goes to disk right away, it's all that's left after a crash
+	BFile file(_JournalPath().String(), B_WRITE_ONLY | B_CREATE_FILE | B_OPEN_AT_END);
+	BString record(line);
+	record << "\n";
+	file.Write(record.String(), record.Length());
+	file.Sync();
+}
+
+
+void
+SegmentEncoder::_Checkpoint(int32 id)
+{
+	// ffmpeg has closed the file, it has to be on disk before it's noted
+	BString path = (id == kAudioTrack) ? _AudioPath() : _SegmentPath(id);
+	BFile(path.String(), B_READ_ONLY).Sync();
+
+	BString line;
+	bigtime_t elapsed = _ActiveTime() - fUnitStart;
+	if (id == kAudioTrack) {
+		fAudioDone = true;
+		line << "audio " << elapsed;
+	} else if (id >= 0 && id < (int32)fSegmentDone.size()) {
+		_SetSegmentDone(id);
+		line << "segment " << id << " " << elapsed;
+	} else
+		return;
+
+	_WriteJournal(line);
+}
+
+
+void
+SegmentEncoder::_SetSegmentDone(int32 segment)
+{
+	fSegmentDone[segment] = true;
+
+	// A finished segment counts fully, but not to the current rates
+	double end = (segment + 1 < (int32)fBoundaries.size())
+		? fBoundaries[segment + 1] : fDuration;
+	ProgressInfo& info = fSegmentProgress[segment];
+	info.time_us = (bigtime_t)((end - fBoundaries[segment]) * 1000000);
+	info.fps = 0;
+	info.speed = 0;
+
+	off_t size;
+	if (BFile(_SegmentPath(segment).String(), B_READ_ONLY).GetSize(&size) == B_OK)
+		info.total_size = size;
+}
+
+
+BString
+SegmentEncoder::_SegmentPath(int32 segment)
+{
+	BPath path(fWorkDirectory);
+	BString name;
+	name.SetToFormat("segment_%04" B_PRId32 ".mkv", segment);
+	path.Append(name);
+	return path.Path();
+}
+
+
+BString
+SegmentEncoder::_AudioPath()
+{
+	BPath path(fWorkDirectory);
+	path.Append("audio.mka");
+	return path.Path();
+}
+
+
+BString
+SegmentEncoder::_JournalPath()
+{
+	BPath path(fWorkDirectory);
+	path.Append("journal");
+	return path.Path();
+}
+
+
+void
+SegmentEncoder::_Post(int32 index, BMessage* command)
+{
+	// A command started while paused is paused right away
+	CommandLauncher* launcher = _LauncherAt(index);
+	launcher->PostMessage(command);
+	if (fPauseStart > 0)
+		launcher->PostMessage(M_PAUSE_COMMAND);
+}
+
+
+bigtime_t
+SegmentEncoder::_ActiveTime()
+{
+	bigtime_t now = system_time();
+	bigtime_t paused = fPausedTime;
+	if (fPauseStart > 0)
+		paused += now - fPauseStart;
+	return now - fStartTime - paused;
+}
+
+
+CommandLauncher*
+SegmentEncoder::_LauncherAt(int32 index)
+{
+	while ((int32)fLaunchers.size() <= index)
+		fLaunchers.push_back(new CommandLauncher(new BMessenger(this)));
+
+	return fLaunchers[index];
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+#ifndef SEGMENTENCODER_H
+#define SEGMENTENCODER_H
+
+
+#include "ProgressParser.h"
+
+#include <Looper.h>
+#include <Messenger.h>
+#include <Path.h>
+#include <String.h>
+#include <StringList.h>
+
+#include <vector>
+
+class CommandLauncher;
+
+
+// Encodes a single source in parallel: the video is split at keyframes into
+// segments that are encoded by separate ffmpeg processes, the audio is
+// encoded once, and everything is joined with the concat demuxer.
+// Commandlines whose options can't be carried over to the parts, and
+// sources with subtitles that would get lost, are encoded by a single
+// process as they are.
+// Accepts the same M_ENCODE_COMMAND / M_STOP_COMMAND messages as the
+// CommandLauncher and answers with M_ENCODE_PROGRESS / M_ENCODE_FINISHED.
+//
+// With a "checkpoint" directory, the segments are shorter and encoded one
+// after the other instead, and every finished one is noted in a journal in
+// that directory. Encoding the same commandline again continues with the
+// first unfinished segment, the time it took to encode the others is sent
+// as "recovered_us". The directory is kept unless the encode succeeded.
+class SegmentEncoder : public BLooper {
+public:
+					SegmentEncoder(BMessenger* target_messenger);
+					~SegmentEncoder();
+
+	void 			MessageReceived(BMessage* message);
+
+	static void		RemoveCheckpoint(const char* directory);
+
+private:
+	bool			_ParseCommandline(const BString& commandline);
+	void			_StartSingle();
+	void			_ProbeStreams();
+	void			_ParseStreams(const char* data);
+	void			_ProbeKeyframes();
+	void			_ParseKeyframes(const char* data);
+	void			_StartSegments();
+	void			_StartNextCheckpoint();
+	void			_StartJoin();
+	BString			_SegmentCommand(int32 segment);
+	BString			_AudioCommand();
+	void			_Finish(int32 exitcode);
+	void			_Abort(int32 exitcode);
+	void			_Cleanup();
+	bool			_ReadJournal();
+	void			_WriteJournal(const BString& line);
+	void			_Checkpoint(int32 id);
+	void			_SetSegmentDone(int32 segment);
+	void			_Post(int32 index, BMessage* command);
+	bigtime_t		_ActiveTime();
+
+	BString			_SegmentPath(int32 segment);
+	BString			_AudioPath();
+	BString			_JournalPath();
+	CommandLauncher*	_LauncherAt(int32 index);
+
+	BMessenger* 	fTargetMessenger;
+	std::vector<CommandLauncher*> fLaunchers;
+
+	// the parsed single-process commandline
+	BString			fCommandline;
+	bool			fShell;
+	BString			fSource;
+	BString			fOutput;
+	BString			fFormat;
+	BString			fInputOptions;
+	BString			fVideoOptions;
+	BString			fAudioOptions;
+	bool			fHasAudio;
+	bool			fNoSubtitles;
+	bool			fSubtitlesFound;
+
+	int32			fDuration;
+	std::vector<double>	fKeyframes;
+	BString			fProbeRest;
+	std::vector<double>	fBoundaries;
+	std::vector<ProgressInfo> fSegmentProgress;
+	int32			fRunning;
+	// "id" of the encode command, passed on to the answers
+	int32			fID;
+
+	bool			fCheckpoint;
+	std::vector<bool> fSegmentDone;
+	bool			fAudioDone;
+	// encoding time of the segments done before, and when the current one
+	// was started (in active time)
+	bigtime_t		fRecovered;
+	bigtime_t		fUnitStart;
+
+	BPath			fWorkDirectory;
+	int32			fState;
+	int32			fErrorCode;
+	// the kind of failure of the first process that failed
+	int32			fError;
+	bigtime_t		fStartTime;
+	bigtime_t		fStopTime;
+	// how much of the source a gracefully stopped encode covers
+	bigtime_t		fStoppedAt;
+	// when the encode was paused, and for how long before
+	bigtime_t		fPauseStart;
+	bigtime_t		fPausedTime;
+
+	int32			fUpdateRate;
+	int32			fUpdateCount;
+	int32			fMessageCount;
+};
+
+
+#endif // SEGMENTENCODER_H
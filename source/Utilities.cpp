@@ -9,12 +9,26 @@
 
 #include "Utilities.h"
 
+#include <BeBuild.h>
 #include <StringList.h>
 
+#include <cctype>
 #include <cstdlib>
+#include <cstring>
 #include <stdio.h>
 
 
+// Use ffmpeg for 2ndary architecture (gcc11+) on 32bit Haiku
+// because vp8 and vp9 codecs are not available on gcc2 builds of ffmpeg_tools
+#ifdef B_HAIKU_32_BIT
+const char* kFFMpeg = "ffmpeg-x86";
+const char* kFFProbe = "ffprobe-x86";
+#else
+const char* kFFMpeg = "ffmpeg";
+const char* kFFProbe = "ffprobe";
+#endif
+
+
 void
 remove_over_precision(BString& float_string)
 {
@@ -67,3 +81,88 @@ string_to_seconds(BString& time_string)
 
 	return seconds;
 }
+
+
+void
+tokenize_commandline(const BString& commandline, BStringList& tokens)
+{
+	// Splits like /bin/sh does: whitespace separates arguments, unless it's
+	// quoted or escaped. Single quotes keep everything literally, inside
+	// double quotes a backslash only escapes \ " $ and `.
+	tokens.MakeEmpty();
+
+	const char* string = commandline.String();
+	BString token;
+	bool in_token = false;
+	char quote = 0;
+
+	for (int32 i = 0; string[i] != '\0'; i++) {
+		char c = string[i];
+
+		if (quote == '\'') {
+			if (c == '\'')
+				quote = 0;
+			else
+				token += c;
+			continue;
+		}
+
+		if (quote == '"') {
+			if (c == '"')
+				quote = 0;
+			else if (c == '\\' && string[i + 1] != '\0'
+				&& strchr("\\\"$`", string[i + 1]) != NULL)
+				token += string[++i];
+			else
+				token += c;
+			continue;
+		}
+
+		if (c == ' ' || c == '\t' || c == '\n') {
+			if (in_token) {
+				tokens.Add(token);
+				token = "";
+				in_token = false;
+			}
+			continue;
+		}
+
+		in_token = true;
+		if (c == '\'' || c == '"')
+			quote = c;
+		else if (c == '\\' && string[i + 1] != '\0')
+			token += string[++i];
+		else
+			token += c;
+	}
+
+	if (in_token)
+		tokens.Add(token);
+}
+
+
+BString
+quote_argument(const BString& argument, bool always)
+{
+	// Arguments with nothing the shell would interpret are left as they are
+	if (!always && !argument.IsEmpty()) {
+		bool safe = true;
+		for (int32 i = 0; i < argument.Length() && safe; i++) {
+			char c = argument.ByteAt(i);
+			safe = isalnum((unsigned char)c) || strchr("_-+=:,./@%", c) != NULL
+				|| (c & 0x80) != 0;
+		}
+		if (safe)
+			return argument;
+	}
+
+	BString quoted("\"");
+	for (int32 i = 0; i < argument.Length(); i++) {
+		char c = argument.ByteAt(i);
+		if (c == '\\' || c == '"' || c == '$' || c == '`')
+			quoted += '\\';
+		quoted += c;
+	}
+	quoted += '"';
+	return quoted;
+}
@@ -9,11 +9,17 @@
 
 
 #include <String.h>
+#include <StringList.h>
 #include <SupportDefs.h>
 
 
+extern const char* kFFMpeg;
+extern const char* kFFProbe;
+
 void	remove_over_precision(BString& float_string);
 void	seconds_to_string(int32 seconds, char* string, size_t stringSize);
 int32	string_to_seconds(BString& time_string);
+void	tokenize_commandline(const BString& commandline, BStringList& tokens);
+BString	quote_argument(const BString& argument, bool always = false);
 
 #endif // UTILITIES_H
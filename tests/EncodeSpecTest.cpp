@@ -0,0 +1,73 @@
+/*
+ * Copyright 2023. All rights reserved.
+ * Distributed under the terms of the MIT License.
+*/
+
+
+#include "EncodeSpec.h"
+
+#include <stdio.h>
+
+
+static int sFailures = 0;
+
+
+static void
+check(bool condition, const char* what)
+{
+	if (!condition) {
+		fprintf(stderr, "FAILED: %s\n", what);
+		sFailures++;
+	}
+}
+
+
+static void
+test_round_trip()
+{
+	const char* line = "ffmpeg -i \"in.mkv\" -f matroska -vcodec mpeg4 -b:v 1000k "
+		"-acodec aac -loglevel error -stats \"out.mkv\"";
+
+	EncodeSpec spec;
+	spec.Parse(line);
+	check(spec.output == "out.mkv", "output of a plain line");
+	check(spec.extra_options.IsEmpty(), "no extra options in a plain line");
+	check(spec.Commandline() == line, "plain line round-trips");
+}
+
+
+static void
+test_trailing_overwrite()
+{
+	// the commandline of a job, as it's sent back to be edited
+	const char* line = "ffmpeg -i \"in.mkv\" -f matroska -vcodec mpeg4 \"out.mkv\"";
+	BString job(line);
+	job << " -y";
+
+	EncodeSpec spec;
+	spec.Parse(job);
+	check(spec.output == "out.mkv", "output in front of -y");
+	check(spec.extra_options.IsEmpty(), "-y isn't an extra option");
+	check(spec.Commandline() == line, "line ending in -y round-trips without it");
+
+	spec.Parse(BString(line) << " -y -y");
+	check(spec.Commandline() == line, "line ending in -y -y round-trips");
+
+	spec.Parse(BString(line) << " -n");
+	check(spec.output == "out.mkv", "output in front of -n");
+}
+
+
+int
+main()
+{
+	test_round_trip();
+	test_trailing_overwrite();
+
+	if (sFailures > 0) {
+		fprintf(stderr, "%d check(s) failed\n", sFailures);
+		return 1;
+	}
+	printf("All EncodeSpec checks passed\n");
+	return 0;
+}